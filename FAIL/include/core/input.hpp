@@ -12,7 +12,8 @@ enum class SpecialKey {
     ArrowDown,
     ArrowLeft,
     ArrowRight,
-    Escape
+    Escape,
+    Resize   // The console window changed size
 };
 
 // Struct for capturing input events
@@ -23,6 +24,7 @@ struct InputEvent {
 };
 
 // Function declarations
+bool inputAvailable();          // True if a key press or a resize is waiting
 InputEvent pollInput();         // Capture user input and return it as an InputEvent
 bool isSpecialKey(InputEvent e); // Check if the input is a special key
 char inputToChar(InputEvent e);  // Convert InputEvent to a character (returns '\0' for special keys)
@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// Which bytes of a 64-byte block belong to the classes the tokenizer cares about: bit i of a
+// mask is byte i of the block. Classified 16 bytes at a time with SSE2 where the compiler has
+// it, a byte at a time from a lookup table elsewhere (or when built with -DNITE_NO_SIMD).
+struct CharClassMasks {
+    uint64_t identifier = 0;   // A-Z a-z 0-9 _
+    uint64_t space = 0;        // Space and tab
+    uint64_t punctuation = 0;  // ; , . ( )
+};
+
+// Classifies the `count` (at most 64) bytes at p; bits past `count` stay clear
+void classifyBlock(const char* p, int count, CharClassMasks& masks);
+
+// Finds class boundaries in one line with bit scans, classifying it a block at a time
+class CharClassScanner {
+    public:
+        explicit CharClassScanner(const std::string& line);
+
+        // The first position at or after `from` whose byte is in pick(masks), or the line's size.
+        // pick may complement a class (~masks.identifier); bits past the end of the line are ignored.
+        template <typename Pick>
+        size_t find(size_t from, Pick pick) {
+            while (from < size) {
+                size_t start = from & ~(size_t)63;
+                if (start != blockStart) {
+                    blockStart = start;
+                    classifyBlock(text + start, (int)std::min<size_t>(64, size - start), masks);
+                }
+                uint64_t hits = pick(masks) & (~(uint64_t)0 << (from - start));
+                if (hits) return std::min(size, start + lowestBit(hits));
+                from = start + 64;
+            }
+            return size;
+        }
+
+    private:
+        const char* text;
+        size_t size;
+        size_t blockStart = (size_t)-1;  // Start of the classified block
+        CharClassMasks masks;
+
+        static int lowestBit(uint64_t mask);
+};
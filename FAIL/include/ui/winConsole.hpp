@@ -16,4 +16,12 @@ void enableRawMode();
 
 void disableRawMode();
 
+// Window size as {width, height}, cached: only refreshed by initConsole() and resize events
 std::pair<int, int> getScreenDimensions();
+
+// Re-reads the window size from the console
+void refreshScreenDimensions();
+
+// Takes buffer-size events off the front of the console input queue, refreshing the cached
+// size; returns true if the window changed size since the last call
+bool takeResizeEvent();
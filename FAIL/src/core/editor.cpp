@@ -1,6 +1,7 @@
 #include "core/editor.hpp"
 #include "core/screen.hpp"
 #include "ui/winConsole.hpp"
+#include <algorithm>
 
 EditorState::EditorState()
     : mode(EditorMode::Normal), cursorRow(0), cursorCol(0), topLine(0) {}
@@ -81,6 +82,14 @@ void EditorState::updateEditor(InputEvent e) {
                     cursorCol = prevLineLength;
                 }
                 break;
+            case SpecialKey::Resize:
+                // Keep the cursor inside the new view; the renderer redraws every row of a new size
+                if (cursorRow > getScreenDimensions().second - 2) {
+                    int overflow = cursorRow - std::max(0, getScreenDimensions().second - 2);
+                    topLine += overflow;
+                    cursorRow -= overflow;
+                }
+                break;
             default:
                 break;
         }
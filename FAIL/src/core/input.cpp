@@ -1,9 +1,24 @@
 #include "core/input.hpp"
+#include "ui/winConsole.hpp"
+
+static bool resizePending = false;  // Seen by inputAvailable(), not yet returned by pollInput()
+
+bool inputAvailable() {
+    if (takeResizeEvent()) resizePending = true;
+    return resizePending || _kbhit();
+}
 
 // Poll for input from the user (keyboard)
 InputEvent pollInput() {
     InputEvent event = {false, '\0', SpecialKey::None};  // Initialize event
 
+    // Window resizes come through the same queue as keys
+    if (takeResizeEvent() || resizePending) {
+        resizePending = false;
+        event.specialKey = SpecialKey::Resize;
+        return event;
+    }
+
     if (_kbhit()) {  // If a key is pressed
         char ch = _getch();  // Get the key
 
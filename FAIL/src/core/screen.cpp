@@ -31,6 +31,10 @@ void refreshScreen(EditorState& editor) {
     // Clear the screen without resetting the cursor
     //clearScreen();  // Keep this as is for clearing the screen content
 
+    // Hide the cursor while the frame is written so it does not flicker across the screen;
+    // renderCursor shows it again at its final position
+    hideCursor();
+
     // Get the buffer from editor
     Buffer& buf = editor.getBuffer();
 
@@ -11,6 +11,7 @@
 // Function declarations
 void initializeEditor();
 void openFile(const std::string& filePath);
+bool handleEvent(const InputEvent& event);
 void mainLoop();
 void shutdownEditor();
 
@@ -51,29 +52,46 @@ void openFile(const std::string& filePath) {
     }
 }
 
+// Applies one input event; returns false once the editor should exit
+bool handleEvent(const InputEvent& event) {
+    // Exit condition
+    if (!event.isChar && event.specialKey == SpecialKey::Escape &&
+        editorState.getMode() == EditorMode::Normal) {
+        return false;
+    }
+
+    // Mode transitions
+    if (!event.isChar && event.specialKey == SpecialKey::Escape) {
+        editorState.setMode(EditorMode::Normal);
+    } else if (event.isChar && event.character == 'i' &&
+               editorState.getMode() == EditorMode::Normal) {
+        editorState.setMode(EditorMode::Insert);
+    } else if (event.isChar && event.character == ':' &&
+               editorState.getMode() == EditorMode::Normal) {
+        editorState.setMode(EditorMode::Command);
+    }
+
+    editorState.updateEditor(event);
+    return true;
+}
+
 void mainLoop() {
-    while (isRunning) {
-        InputEvent event = pollInput();
+    const DWORD frameInterval = 16;  // Redraw at most ~60 times a second while keys keep arriving
 
-        // Exit condition
-        if (!event.isChar && event.specialKey == SpecialKey::Escape &&
-            editorState.getMode() == EditorMode::Normal) {
-            isRunning = false;
-            break;
+    while (isRunning) {
+        // Nothing to do until a key or a resize arrives; no event means nothing to redraw either
+        if (!inputAvailable()) {
+            Sleep(5);
+            continue;
         }
 
-        // Mode transitions
-        if (!event.isChar && event.specialKey == SpecialKey::Escape) {
-            editorState.setMode(EditorMode::Normal);
-        } else if (event.isChar && event.character == 'i' &&
-                   editorState.getMode() == EditorMode::Normal) {
-            editorState.setMode(EditorMode::Insert);
-        } else if (event.isChar && event.character == ':' &&
-                   editorState.getMode() == EditorMode::Normal) {
-            editorState.setMode(EditorMode::Command);
+        // Apply every key that is already queued (key repeat, paste), then draw once
+        DWORD frameStart = GetTickCount();
+        while (isRunning && inputAvailable() && GetTickCount() - frameStart < frameInterval) {
+            isRunning = handleEvent(pollInput());
         }
+        if (!isRunning) break;
 
-        editorState.updateEditor(event);
         editorState.renderEditor();
     }
 }
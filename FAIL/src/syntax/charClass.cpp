@@ -0,0 +1,76 @@
+#include "syntax/charClass.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(NITE_NO_SIMD)
+#define NITE_SSE2
+#include <emmintrin.h>
+#else
+namespace {
+    enum : uint8_t { IDENTIFIER = 1, SPACE = 2, PUNCTUATION = 4 };
+
+    constexpr std::array<uint8_t, 256> buildClassTable() {
+        std::array<uint8_t, 256> table{};
+        for (int c = 'a'; c <= 'z'; ++c) table[c] = table[c - 'a' + 'A'] = IDENTIFIER;
+        for (int c = '0'; c <= '9'; ++c) table[c] = IDENTIFIER;
+        table['_'] = IDENTIFIER;
+        table[' '] = table['\t'] = SPACE;
+        table[';'] = table[','] = table['.'] = table['('] = table[')'] = PUNCTUATION;
+        return table;
+    }
+
+    constexpr std::array<uint8_t, 256> CLASSES = buildClassTable();
+}
+#endif
+
+void classifyBlock(const char* p, int count, CharClassMasks& masks) {
+    masks = CharClassMasks();
+#ifdef NITE_SSE2
+    // Only the 16-byte chunks holding text are classified; a short last one is read from a zeroed copy
+    for (int shift = 0; shift < count; shift += 16) {
+        __m128i c;
+        if (count - shift >= 16) {
+            c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + shift));
+        } else {
+            alignas(16) char tail[16] = {};
+            std::memcpy(tail, p + shift, count - shift);
+            c = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+        auto is = [c](char ch) { return _mm_cmpeq_epi8(c, _mm_set1_epi8(ch)); };
+        auto bits = [shift](__m128i v) { return (uint64_t)(uint32_t)_mm_movemask_epi8(v) << shift; };
+
+        // Signed compares: bytes from 0x80 up are negative, so they fall outside every range
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        masks.identifier |= bits(_mm_or_si128(_mm_or_si128(letter, digit), is('_')));
+        masks.space |= bits(_mm_or_si128(is(' '), is('\t')));
+        masks.punctuation |= bits(_mm_or_si128(_mm_or_si128(is(';'), is(',')), _mm_or_si128(is('.'), _mm_or_si128(is('('), is(')')))));
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        uint8_t classes = CLASSES[(unsigned char)p[i]];
+        uint64_t bit = (uint64_t)1 << i;
+        if (classes & IDENTIFIER) masks.identifier |= bit;
+        if (classes & SPACE) masks.space |= bit;
+        if (classes & PUNCTUATION) masks.punctuation |= bit;
+    }
+#endif
+}
+
+CharClassScanner::CharClassScanner(const std::string& line)
+    : text(line.data()), size(line.size()) {
+}
+
+int CharClassScanner::lowestBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
@@ -1,29 +1,35 @@
 #include "syntax/clangCpp.hpp"
+#include "syntax/charClass.hpp"
 
-// Helper function to tokenize a line of code
+// Helper function to tokenize a line of code. Runs of identifier characters, and the next
+// character that ends a token, are found with bit scans over the classified line.
 void tokenizeLine(const std::string& line, std::vector<std::shared_ptr<Token>>& tokens) {
     std::string value;
     TokenType currentType = TokenType::Unknown;
+    CharClassScanner scan(line);
 
-    for (size_t i = 0; i < line.size(); ++i) {
+    size_t i = 0;
+    while ((i = scan.find(i, [](const CharClassMasks& m) { return m.identifier | m.space | m.punctuation; })) < line.size()) {
         char ch = line[i];
 
         // Tokenize based on simple C++ syntax (e.g., keywords, operators, literals)
-        if (std::isalnum(ch) || ch == '_') { // If alphanumeric or underscore, we might have an identifier or literal
-            value += ch;
+        if (std::isalnum((unsigned char)ch) || ch == '_') { // If alphanumeric or underscore, we might have an identifier or literal
+            size_t end = scan.find(i, [](const CharClassMasks& m) { return ~m.identifier; });
+            value.append(line, i, end - i);
             currentType = TokenType::Identifier; // Initially treat as identifier
-        } else if (ch == ' ' || ch == '\t') {
-            if (!value.empty()) {
-                tokens.push_back(std::make_shared<Token>(value, currentType));
-                value.clear();
-            }
-        } else if (ch == ';' || ch == ',' || ch == '.' || ch == '(' || ch == ')') {
-            if (!value.empty()) {
-                tokens.push_back(std::make_shared<Token>(value, currentType));
-                value.clear();
-            }
+            i = end;
+            continue;
+        }
+
+        // Whitespace or punctuation ends the token being built
+        if (!value.empty()) {
+            tokens.push_back(std::make_shared<Token>(value, currentType));
+            value.clear();
+        }
+        if (ch != ' ' && ch != '\t') {
             tokens.push_back(std::make_shared<Token>(std::string(1, ch), TokenType::Punctuation));
         }
+        ++i;
         // Add more tokenization rules here (e.g., for operators, comments, etc.)
     }
 
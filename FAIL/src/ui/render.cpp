@@ -1,13 +1,35 @@
 #include "ui/render.hpp"
 #include "ui/winConsole.hpp"
+#include <algorithm>
+#include <vector>
 
-// The buffer that holds the current frame
-std::string lastRenderedBuffer;
+// The rows currently on screen, so a frame only rewrites the cells that changed
+std::vector<std::string> lastRenderedLines;
+
+// Writes the part of `row` that differs from what is already on screen
+static void drawChangedSpan(int row, const std::string& line, std::string& onScreen) {
+    if (onScreen.size() != line.size()) {
+        setCursorPosition(0, row);
+        std::cout << line;
+        onScreen = line;
+        return;
+    }
+
+    size_t first = 0;
+    while (first < line.size() && line[first] == onScreen[first]) ++first;
+    if (first == line.size()) return;  // Row unchanged, nothing to write
+
+    size_t last = line.size();
+    while (last > first && line[last - 1] == onScreen[last - 1]) --last;
+
+    setCursorPosition((int)first, row);
+    std::cout.write(line.data() + first, last - first);
+    std::copy(line.begin() + first, line.begin() + last, onScreen.begin() + first);
+}
 
 void renderBuffer(Buffer& buf, EditorState& editor) {
     auto [screenWidth, screenHeight] = getScreenDimensions();
     int bufferLines = buf.lines.size();
-    int cursorRow = editor.getCursorRow();
     int cursorCol = editor.getCursorCol();
     
     int viewHeight = screenHeight - 1; // Leave one line for status bar
@@ -20,34 +42,25 @@ void renderBuffer(Buffer& buf, EditorState& editor) {
 
     // Vertical scrolling logic
     int topLine = editor.topLine;
-    int linesToRender = std::min(bufferLines - topLine, viewHeight);
 
-    std::string currentBuffer; // This will hold the buffer we need to render
-
-    for (int i = 0; i < linesToRender; ++i) {
-        std::string line = buf.getLine(topLine + i);
-        
-        // Render the visible part of the line
-        if (leftCol < line.length()) {
-            std::string visibleLine = line.substr(leftCol, screenWidth);
-            currentBuffer += visibleLine;
-        }
-        
-        // Clear the rest of the line
-        currentBuffer += std::string(screenWidth - std::min((int)line.length() - leftCol, screenWidth), ' ') + "\n";
+    // A resize leaves the screen contents unknown, so every row is redrawn
+    if ((int)lastRenderedLines.size() != viewHeight) {
+        lastRenderedLines.assign(std::max(0, viewHeight), std::string());
     }
 
-    // Clear remaining lines if necessary
-    for (int i = linesToRender; i < viewHeight; ++i) {
-        currentBuffer += std::string(screenWidth, ' ') + "\n";
-    }
+    for (int i = 0; i < viewHeight; ++i) {
+        std::string visibleLine;
+        if (topLine + i < bufferLines) {
+            std::string line = buf.getLine(topLine + i);
+            if (leftCol < (int)line.length()) {
+                visibleLine = line.substr(leftCol, screenWidth);  // The visible part of the line
+            }
+        }
+        visibleLine.resize(screenWidth, ' ');  // Clear the rest of the row
 
-    // Only update the screen if the buffer content has changed
-    if (currentBuffer != lastRenderedBuffer) {
-        setCursorPosition(0, 0);  // Set to the top-left corner for screen clearing
-        std::cout << currentBuffer;
-        lastRenderedBuffer = currentBuffer;  // Update last rendered buffer
+        drawChangedSpan(i, visibleLine, lastRenderedLines[i]);
     }
+    std::cout.flush();
 }
 
 void renderStatusBar(EditorState& editor) {
@@ -56,11 +69,19 @@ void renderStatusBar(EditorState& editor) {
     int cursorCol = editor.getCursorCol();
     EditorMode mode = editor.getMode();
 
-    setCursorPosition(0, screenHeight - 1);
-    std::cout << "Mode: " << (mode == EditorMode::Normal ? "Normal" :
-                              mode == EditorMode::Insert ? "Insert" : "Command")
-              << " | Row: " << cursorRow << " | Col: " << cursorCol
-              << std::string(screenWidth, ' ');  // Clear the rest of the line
+    std::string status = std::string("Mode: ") + (mode == EditorMode::Normal ? "Normal" :
+                                                  mode == EditorMode::Insert ? "Insert" : "Command") +
+                         " | Row: " + std::to_string(cursorRow) + " | Col: " + std::to_string(cursorCol);
+
+    // Pad to one short of the width: writing the bottom-right cell scrolls the console
+    status.resize(std::max(0, screenWidth - 1), ' ');
+
+    static std::string lastStatus;
+    if (status != lastStatus) {
+        setCursorPosition(0, screenHeight - 1);
+        std::cout << status << std::flush;
+        lastStatus = status;
+    }
 }
 
 void renderCursor(EditorState& editor) {
@@ -1,11 +1,21 @@
 #include "ui/winConsole.hpp"
 
 static HANDLE hConsole = nullptr;
+static HANDLE hInput = nullptr;
 static DWORD originalMode = 0;
+static std::pair<int, int> screenDimensions = {0, 0};  // Cached so drawing and key handling never query the console
 
 void initConsole() {
     hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     GetConsoleMode(hConsole, &originalMode);
+
+    // Ask for an input event whenever the screen buffer changes size
+    hInput = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD inputMode = 0;
+    GetConsoleMode(hInput, &inputMode);
+    SetConsoleMode(hInput, inputMode | ENABLE_WINDOW_INPUT);
+
+    refreshScreenDimensions();
 }
 
 void setCursorPosition(int x, int y) {
@@ -41,11 +51,41 @@ void disableRawMode() {
 
 // Method to get the screen dimensions (width and height)
 std::pair<int, int> getScreenDimensions() {
+    return screenDimensions;
+}
+
+void refreshScreenDimensions() {
     CONSOLE_SCREEN_BUFFER_INFO csbi;
     if (GetConsoleScreenBufferInfo(hConsole, &csbi)) {
-        return {csbi.srWindow.Right - csbi.srWindow.Left + 1,
-                csbi.srWindow.Bottom - csbi.srWindow.Top + 1};
+        screenDimensions = {csbi.srWindow.Right - csbi.srWindow.Left + 1,
+                            csbi.srWindow.Bottom - csbi.srWindow.Top + 1};
+    } else {
+        // In case of error, report (0, 0)
+        screenDimensions = {0, 0};
+    }
+}
+
+// Whether _getch() returns anything for this key press: a character, or 0/224 and a scan code
+// for arrows, Home/End, Page Up/Down, Insert/Delete and F1-F12
+static bool getchReturns(const KEY_EVENT_RECORD& key) {
+    if (key.uChar.AsciiChar != 0) return true;
+    WORD code = key.wVirtualKeyCode;
+    return (code >= VK_PRIOR && code <= VK_DOWN) || code == VK_INSERT || code == VK_DELETE ||
+           (code >= VK_F1 && code <= VK_F12);
+}
+
+bool takeResizeEvent() {
+    // _kbhit()/_getch() would silently discard these records, so they are read here first. Everything
+    // up to the next key press _getch() returns is taken: resize records are noted, the rest (key-ups,
+    // focus and mouse records, Caps Lock and the like) dropped, so none of it hides a resize behind it.
+    bool resized = false;
+    INPUT_RECORD record;
+    DWORD count = 0;
+    while (PeekConsoleInputA(hInput, &record, 1, &count) && count == 1) {
+        if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown && getchReturns(record.Event.KeyEvent)) break;
+        ReadConsoleInputA(hInput, &record, 1, &count);
+        if (record.EventType == WINDOW_BUFFER_SIZE_EVENT) resized = true;
     }
-    // In case of error, return (0, 0)
-    return {0, 0};
+    if (resized) refreshScreenDimensions();
+    return resized;
 }
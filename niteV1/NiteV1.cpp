@@ -6,13 +6,102 @@
 #include <vector>       // Includes the vector container library for dynamic arrays.
 #include <string>       // Includes the string class library for string manipulation.
 #include <algorithm>    // Includes algorithms like sort(), find(), etc.
+#ifdef _WIN32
 #include <windows.h>    // Includes Windows-specific functions for system-level access.
 #include <conio.h>      // Includes console I/O functions like getch() and kbhit().
+#else
+#include <termios.h>    // Includes terminal settings for raw keyboard input.
+#include <unistd.h>     // Includes read(), write() and readlink().
+#include <poll.h>       // Includes poll() to wait for input with a timeout.
+#include <fcntl.h>      // Includes open() for memory-mapped files.
+#include <sys/ioctl.h>  // Includes ioctl() to query the terminal window size.
+#include <sys/mman.h>   // Includes mmap() for memory-mapped files.
+#include <sys/stat.h>   // Includes fstat() to get a file's size.
+#include <signal.h>     // Includes sigaction() to hear about window resizes (SIGWINCH).
+#include <cerrno>       // Includes errno, kept intact by the signal handler.
+#endif
 #include <fstream>      // Includes file stream classes for file handling.
 #include <sstream>      // Includes string stream classes for reading from and writing to strings.
 #include <cstdlib>      // Includes functions like std::exit() and random number generation.
 #include <unordered_map> // Includes unordered_map for hash table-like data structures.
 #include <filesystem>  // Includes filesystem library for file and directory manipulation.
+#include <cstring>      // Includes C string functions like memchr() and memcmp().
+#include <array>        // Includes std::array for fixed-size lookup tables.
+#include <memory>       // Includes smart pointers like std::unique_ptr.
+#include <deque>        // Includes std::deque for the per-worker task queues.
+#include <functional>   // Includes std::function for queued tasks.
+#include <thread>       // Includes std::thread for background workers.
+#include <mutex>        // Includes std::mutex and std::lock_guard for shared state.
+#include <condition_variable> // Includes std::condition_variable to park idle workers.
+#include <atomic>       // Includes std::atomic for lock-free counters and flags.
+#include <string_view>  // Includes std::string_view for non-owning views into the path pool.
+#include <chrono>       // Includes std::chrono durations for sleeps and timeouts.
+#include <climits>      // Includes INT_MAX for "no limit" arguments.
+#include <cstdio>       // Includes fopen() with "x" to create a file only if it does not exist yet.
+#include <random>       // Includes std::random_device and std::mt19937_64 for unique scratch file names.
+#include <unordered_set> // Includes unordered_set for sets of canonical paths.
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(NITE_NO_SIMD)
+#define NITE_SSE2
+#include <emmintrin.h>  // Includes SSE2 intrinsics for classifying 16 characters at a time.
+#endif
+
+#ifndef _WIN32
+// Console attribute bits with the same values as <wincon.h>, so colors stay plain WORDs on every platform
+typedef unsigned short WORD;
+const WORD FOREGROUND_BLUE = 0x0001;
+const WORD FOREGROUND_GREEN = 0x0002;
+const WORD FOREGROUND_RED = 0x0004;
+const WORD FOREGROUND_INTENSITY = 0x0008;
+const WORD BACKGROUND_BLUE = 0x0010;
+const WORD BACKGROUND_GREEN = 0x0020;
+const WORD BACKGROUND_RED = 0x0040;
+const WORD BACKGROUND_INTENSITY = 0x0080;
+
+// Virtual-key codes the file browser understands
+const int VK_RETURN = 0x0D;
+const int VK_ESCAPE = 0x1B;
+const int VK_UP = 0x26;
+const int VK_DOWN = 0x28;
+#endif
+
+// === Allocation Counter ===
+// Debug builds (make debug) count every heap allocation per thread, so a frame can check that
+// drawing it did not allocate. Release builds use the standard allocator untouched.
+#ifdef NITE_DEBUG_ALLOCS
+thread_local size_t allocationCount = 0;
+
+// The whole replaceable set is swapped out together (plain, array, sized and nothrow forms),
+// so every new is paired with a delete from the same allocator. Both ends stay out of line:
+// with malloc/free inlined into a caller, GCC sees "operator new" paired with "free" and warns.
+#if defined(__GNUC__)
+#define NITE_NOINLINE __attribute__((noinline))
+#else
+#define NITE_NOINLINE __declspec(noinline)
+#endif
+
+NITE_NOINLINE void* countedAllocate(std::size_t size) noexcept {
+    ++allocationCount;
+    return std::malloc(size ? size : 1);
+}
+NITE_NOINLINE void countedRelease(void* block) noexcept { std::free(block); }
+
+void* operator new(std::size_t size) {
+    if (void* block = countedAllocate(size)) return block;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* block = countedAllocate(size)) return block;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void operator delete(void* block) noexcept { countedRelease(block); }
+void operator delete[](void* block) noexcept { countedRelease(block); }
+void operator delete(void* block, std::size_t) noexcept { countedRelease(block); }
+void operator delete[](void* block, std::size_t) noexcept { countedRelease(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { countedRelease(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { countedRelease(block); }
+#endif
 
 // === Color Lookup ===
 std::unordered_map<std::string, WORD> colorMap = {
@@ -70,19 +159,210 @@ WORD NULL_COLOR = FOREGROUND_RED;
 WORD PREPROCESSOR_COLOR = FOREGROUND_BLUE | FOREGROUND_GREEN;
 WORD MISC_COLOR = FOREGROUND_BLUE | FOREGROUND_RED;
 WORD HIGHLIGHT_COLOR = BACKGROUND_BLUE | BACKGROUND_RED | BACKGROUND_INTENSITY;
+WORD MATCH_COLOR = BACKGROUND_RED | BACKGROUND_GREEN;
+WORD WATCH_COLOR = BACKGROUND_RED;
+WORD BRACKET_COLOR = BACKGROUND_GREEN | BACKGROUND_BLUE;
 
 // Some other cool values
 bool syntaxHighlighting = false;
+bool softWrap = false;  // Wrap long lines onto the next screen rows instead of scrolling sideways
+bool showMinimap = false;  // Overview strip of the whole file along the right edge of the editor
 int tabSize = 4;
 
-// === Parser ===
-void loadColorConfig(const std::string& filepath) {
-    std::ifstream file(filepath);
+// Performance governor thresholds (see PerformanceGovernor)
+bool governorEnabled = true;   // Cut back detail when frames run over budget
+int frameBudgetMs = 16;        // Time an editor frame may take to compose
+int longLineLimitKB = 4;       // Lines longer than this are the first to lose highlighting
+int matchCountLines = 20000;   // Lines the match counter may scan per frame while cut back
+int idleRestoreMs = 500;       // Quiet time after which everything comes back
+
+// === Theme Palette ===
+
+// What each of the 16 console colors looks like, as 0xRRGGBB. A theme sets them with
+// `palette_<color> = r,g,b` or `palette_<color> = <0-255>` (an xterm 256-color index);
+// -1 leaves that color to the terminal.
+struct Palette {
+    std::array<int, 16> rgb;
+
+    Palette() { rgb.fill(-1); }
+
+    bool empty() const {
+        return std::all_of(rgb.begin(), rgb.end(), [](int color) { return color < 0; });
+    }
+};
+
+std::shared_ptr<const Palette> themePalette;  // Palette of the loaded theme (null if it sets none)
+
+// RGB of an xterm 256-color index: 16 system colors, a 6x6x6 cube, then 24 grays
+int xtermColorRgb(int index) {
+    static const int system[16] = { 0x000000, 0x800000, 0x008000, 0x808000, 0x000080, 0x800080, 0x008080, 0xc0c0c0,
+                                    0x808080, 0xff0000, 0x00ff00, 0xffff00, 0x0000ff, 0xff00ff, 0x00ffff, 0xffffff };
+    static const int level[6] = { 0, 95, 135, 175, 215, 255 };
+    if (index < 16) return system[index];
+    if (index < 232) {
+        index -= 16;
+        return (level[index / 36] << 16) | (level[index / 6 % 6] << 8) | level[index % 6];
+    }
+    int gray = 8 + (index - 232) * 10;
+    return (gray << 16) | (gray << 8) | gray;
+}
+
+// Closest xterm 256-color index to an RGB color. Only the cube and the gray ramp are candidates,
+// since terminals disagree about the 16 system colors.
+int nearestXtermColor(int rgb) {
+    int r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+    auto cubeLevel = [](int v) { return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40; };
+    int cube = 16 + 36 * cubeLevel(r) + 6 * cubeLevel(g) + cubeLevel(b);
+    int gray = 232 + std::min(23, std::max(0, ((r + g + b) / 3 - 3) / 10));
+
+    auto distance = [r, g, b](int index) {
+        int other = xtermColorRgb(index);
+        int dr = r - ((other >> 16) & 0xFF), dg = g - ((other >> 8) & 0xFF), db = b - (other & 0xFF);
+        return dr * dr + dg * dg + db * db;
+    };
+    return distance(cube) <= distance(gray) ? cube : gray;
+}
+
+// Parses a palette value: "r,g,b" or an xterm color index; -1 if it is neither
+int parsePaletteColor(const std::string& text) {
+    int r, g, b;
+    char comma1, comma2;
+    std::istringstream rgbStream(text);
+    if (rgbStream >> r >> comma1 >> g >> comma2 >> b && comma1 == ',' && comma2 == ',') {
+        if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) return -1;
+        return (r << 16) | (g << 8) | b;
+    }
+    std::istringstream indexStream(text);
+    int index;
+    if (indexStream >> index && (indexStream >> std::ws).eof() && index >= 0 && index <= 255) return xtermColorRgb(index);
+    return -1;
+}
+
+// === Watch Terms ===
+
+// Aho-Corasick automaton over the watch-list terms from .niteconfig. It is compiled into a
+// dense DFA once per config load, so highlighting any number of terms is a single table walk
+// per visible line instead of one find() per term.
+class AhoCorasick {
+    private:
+        std::array<uint16_t, 256> byteClass{}; // Byte -> compact alphabet index (0 = byte not used by any term; up to 256 used ones)
+        int alphabetSize = 1;
+        std::vector<int> next;                 // DFA transitions: state * alphabetSize + class -> state
+        std::vector<int> matchLength;          // Length of the longest term ending in each state (0 = none)
+        int longest = 0;
+
+    public:
+        void build(const std::vector<std::string>& terms) {
+            byteClass.fill(0);
+            alphabetSize = 1;
+            longest = 0;
+            for (const auto& term : terms) {
+                for (unsigned char c : term) {
+                    if (!byteClass[c]) byteClass[c] = (uint16_t)alphabetSize++;
+                }
+            }
+
+            // Build the trie; -1 marks a missing edge until the BFS below fills it in
+            next.assign(alphabetSize, -1);
+            matchLength.assign(1, 0);
+            for (const auto& term : terms) {
+                if (term.empty()) continue;
+                int state = 0;
+                for (unsigned char c : term) {
+                    int& edge = next[state * alphabetSize + byteClass[c]];
+                    if (edge < 0) {
+                        edge = (int)matchLength.size();
+                        matchLength.push_back(0);
+                        next.resize(next.size() + alphabetSize, -1);
+                    }
+                    state = next[state * alphabetSize + byteClass[c]];
+                }
+                matchLength[state] = std::max(matchLength[state], (int)term.size());
+                longest = std::max(longest, (int)term.size());
+            }
+
+            // Breadth-first pass turns the trie into a DFA by following failure links
+            std::vector<int> fail(matchLength.size(), 0);
+            std::vector<int> queue;
+            for (int cls = 0; cls < alphabetSize; ++cls) {
+                int& edge = next[cls];
+                if (edge < 0) edge = 0;
+                else queue.push_back(edge);
+            }
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int state = queue[head];
+                matchLength[state] = std::max(matchLength[state], matchLength[fail[state]]);
+                for (int cls = 0; cls < alphabetSize; ++cls) {
+                    int& edge = next[state * alphabetSize + cls];
+                    int fallback = next[fail[state] * alphabetSize + cls];
+                    if (edge < 0) {
+                        edge = fallback;
+                    } else {
+                        fail[edge] = fallback;
+                        queue.push_back(edge);
+                    }
+                }
+            }
+        }
+
+        bool empty() const { return longest == 0; }
+        int maxTermLength() const { return longest; }
+
+        // Appends the merged [start, end) spans covered by terms ending inside text[from, to)
+        void findSpans(const std::string& text, int from, int to, std::vector<std::pair<int, int>>& out) const {
+            if (empty()) return;
+            int state = 0;
+            for (int i = from; i < to; ++i) {
+                state = next[state * alphabetSize + byteClass[(unsigned char)text[i]]];
+                int length = matchLength[state];
+                if (!length) continue;
+                int start = std::max(from, i + 1 - length);
+                if (!out.empty() && start <= out.back().second) {
+                    out.back().second = i + 1;
+                } else {
+                    out.emplace_back(start, i + 1);
+                }
+            }
+        }
+};
+
+std::vector<std::string> watchTerms;  // Literal terms that are always highlighted
+AhoCorasick watchAutomaton;           // Compiled matcher for watchTerms, rebuilt on every config load
+
+// Reads one watch term per line from a watch_list file (blank lines and # comments are skipped)
+void loadWatchList(const std::filesystem::path& path) {
+    std::ifstream file(path);
     if (!file.is_open()) {
-        std::cerr << "Could not open .niteconfig file.\n";
+        std::cerr << "Could not open watch list: " << path.string() << "\n";
         return;
     }
+    std::string term;
+    while (std::getline(file, term)) {
+        if (!term.empty() && term.back() == '\r') term.pop_back();
+        if (term.empty() || term[0] == '#') continue;
+        watchTerms.push_back(term);
+    }
+}
+
+// === Parser ===
+
+// Reads an integer setting into `target` if it parses and lies in [low, high]; otherwise keeps the old value
+void parseConfigInt(const std::string& key, const std::string& value, int low, int high, int& target) {
+    try {
+        int parsed = std::stoi(value);
+        if (parsed < low || parsed > high) {
+            std::cerr << "Invalid " << key << " value. Must be between " << low << " and " << high << ".\n";
+        } else {
+            target = parsed;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid " << key << " value: " << value << "\n";
+    }
+}
 
+// Applies the settings of one config or theme file. A `theme = <name>` line pulls in
+// <name>.nitetheme from the same directory, whose lines use the same keys.
+void applyConfig(std::istream& file, const std::filesystem::path& directory, Palette& palette, bool allowTheme) {
     std::unordered_map<std::string, WORD*> colorTargets = {
         {"default", &DEFAULT_COLOR},
         {"type", &TYPE_COLOR},
@@ -101,11 +381,31 @@ void loadColorConfig(const std::string& filepath) {
         {"null", &NULL_COLOR},
         {"preprocessor", &PREPROCESSOR_COLOR},
         {"misc", &MISC_COLOR},
-        {"highlight", &HIGHLIGHT_COLOR}
+        {"highlight", &HIGHLIGHT_COLOR},
+        {"match", &MATCH_COLOR},
+        {"watch", &WATCH_COLOR},
+        {"bracket", &BRACKET_COLOR}
     };
 
     std::string line;
     while (std::getline(file, line)) {
+        // Watch terms are case-sensitive and may contain spaces and '#', so they are taken from the
+        // raw text after '=' before comments are stripped
+        size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            std::string rawKey = line.substr(0, equals);
+            rawKey.erase(0, rawKey.find_first_not_of(" \t"));
+            rawKey.erase(rawKey.find_last_not_of(" \t") + 1);
+            std::transform(rawKey.begin(), rawKey.end(), rawKey.begin(), ::tolower);
+            if (rawKey == "watch_term") {
+                std::string term = line.substr(equals + 1);
+                term.erase(0, term.find_first_not_of(" \t"));
+                term.erase(term.find_last_not_of(" \t\r") + 1);
+                if (!term.empty()) watchTerms.push_back(term);
+                continue;
+            }
+        }
+
         // Remove comments and whitespace
         size_t comment = line.find('#');
         if (comment != std::string::npos)
@@ -115,12 +415,43 @@ void loadColorConfig(const std::string& filepath) {
         if (!(iss >> key >> eq >> value) || eq != "=")
             continue;
 
+        // File names and palette entries are case-sensitive, so keep the raw text after '='
+        std::string rawValue = line.substr(line.find('=') + 1);
+        rawValue.erase(0, rawValue.find_first_not_of(" \t"));
+        rawValue.erase(rawValue.find_last_not_of(" \t\r") + 1);
+
         // Normalize the key and value
         std::transform(key.begin(), key.end(), key.begin(), ::tolower);
         std::transform(value.begin(), value.end(), value.begin(), ::tolower);
 
+        // Process watch lists (a whole file of watch terms, one per line)
+        if (key == "watch_list") {
+            loadWatchList(directory / rawValue);
+        }
+
+        // Pull in a theme file
+        else if (key == "theme" && allowTheme) {
+            std::ifstream theme(directory / (rawValue + ".nitetheme"));
+            if (theme.is_open()) {
+                applyConfig(theme, directory, palette, false);
+            } else {
+                std::cerr << "Could not open theme: " << rawValue << "\n";
+            }
+        }
+
+        // Process palette colors (what one of the 16 named colors looks like)
+        else if (key.compare(0, 8, "palette_") == 0) {
+            auto color = colorMap.find(key.substr(8));
+            int rgb = parsePaletteColor(rawValue);
+            if (color == colorMap.end() || color->second > 0x0F || rgb < 0) {
+                std::cerr << "Invalid palette entry: " << key << "\n";
+            } else {
+                palette.rgb[color->second] = rgb;
+            }
+        }
+
         // Process color mappings
-        if (colorMap.count(value) && colorTargets.count(key)) {
+        else if (colorMap.count(value) && colorTargets.count(key)) {
             *colorTargets[key] = colorMap[value];
         }
 
@@ -135,6 +466,51 @@ void loadColorConfig(const std::string& filepath) {
             }
         }
 
+        // Process 'softWrap' (boolean)
+        else if (key == "softwrap") {
+            if (value == "true") {
+                softWrap = true;
+            } else if (value == "false") {
+                softWrap = false;
+            } else {
+                std::cerr << "Invalid value for softWrap in config.\n";
+            }
+        }
+
+        // Process 'minimap' (boolean)
+        else if (key == "minimap") {
+            if (value == "true") {
+                showMinimap = true;
+            } else if (value == "false") {
+                showMinimap = false;
+            } else {
+                std::cerr << "Invalid value for minimap in config.\n";
+            }
+        }
+
+        // Process the performance governor settings
+        else if (key == "governor") {
+            if (value == "true") {
+                governorEnabled = true;
+            } else if (value == "false") {
+                governorEnabled = false;
+            } else {
+                std::cerr << "Invalid value for governor in config.\n";
+            }
+        }
+        else if (key == "framebudget") {
+            parseConfigInt("frameBudget", value, 1, 1000, frameBudgetMs);
+        }
+        else if (key == "longlinelimit") {
+            parseConfigInt("longLineLimit", value, 1, 1 << 20, longLineLimitKB);
+        }
+        else if (key == "matchcountlines") {
+            parseConfigInt("matchCountLines", value, 1, 1 << 30, matchCountLines);
+        }
+        else if (key == "idlerestore") {
+            parseConfigInt("idleRestore", value, 0, 60000, idleRestoreMs);
+        }
+
         // Process 'tabSize' (integer)
         else if (key == "tabsize") {
             try {
@@ -154,6 +530,24 @@ void loadColorConfig(const std::string& filepath) {
     }
 }
 
+void loadColorConfig(const std::string& filepath) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Could not open .niteconfig file.\n";
+        return;
+    }
+
+    watchTerms.clear();
+    Palette palette;
+    applyConfig(file, std::filesystem::path(filepath).parent_path(), palette, true);
+
+    // The palette is handed to the renderer with each frame; it compiles its escape codes once per palette
+    themePalette = palette.empty() ? nullptr : std::make_shared<const Palette>(palette);
+
+    // Compile the watch terms once here so drawing never has to
+    watchAutomaton.build(watchTerms);
+}
+
 // Struct to represent different types of actions that can be performed in an editor-like environment
 struct Action {
 
@@ -180,333 +574,3991 @@ std::vector<Action> undoStack;  // A stack (vector) to store actions for undo fu
 std::vector<Action> redoStack;  // A stack (vector) to store actions for redo functionality, allowing you to reapply an undone action.
 std::vector<std::string> fileStack; // A stack (vector) to store file names for file navigation, allowing you to go back to previously opened files.
 
-namespace fs = std::filesystem;
+// === Search ===
 
-class FileNavigator {
+// Lays an overlay color (search hit, selection, ...) over a syntax color. Background-only
+// overlays keep the underlying foreground so highlighted keywords stay readable.
+WORD overlayColor(WORD base, WORD overlay) {
+    if ((overlay & 0x0F) == 0) return (base & 0x0F) | overlay;
+    return overlay;
+}
+
+// Rough rank of how common a byte is in source code and logs (lower = rarer).
+int byteFrequencyRank(unsigned char c) {
+    static const char common[] = " etaoinsrhldcumfpgwybvkxjqz_ETAOINSRHLDCUMFPGWYBVKXJQZ0123456789.,;:()=\"'-/*<>{}[]";
+    const char* hit = c ? std::strchr(common, c) : nullptr;
+    return hit ? (int)sizeof(common) - (int)(hit - common) : 0;
+}
+
+// Literal substring finder. Instead of testing every position it anchors on the needle's
+// rarest byte and lets memchr (vectorized in every libc) skip to candidates, then verifies
+// the whole needle with memcmp.
+class LiteralSearcher {
     private:
-        fs::path currentDirectory;
-        std::vector<fs::path> entries;
-        int selectedIndex = 0;
-        int scrollOffset = 0;
-        int screenRows;
-        int screenCols;
-        
-        // Colors for file browser (matching your existing color scheme)
-        const WORD DIRECTORY_COLOR = FOREGROUND_BLUE | FOREGROUND_INTENSITY;
-        const WORD FILE_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
-        const WORD SELECTED_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
-        
-        // Refresh the list of entries in the current directory
-        void refreshEntries() {
-            entries.clear();
-            
-            // Add parent directory entry (..) if not at root
-            if (currentDirectory.has_parent_path() && 
-                currentDirectory != currentDirectory.root_path()) {
-                entries.push_back(currentDirectory.parent_path());
+        std::string needle;
+        size_t rareIndex = 0;  // Index of the anchor byte inside the needle
+        char rareByte = 0;     // The anchor byte itself
+
+    public:
+        explicit LiteralSearcher(const std::string& pattern = "") : needle(pattern) {
+            int bestRank = 1 << 30;
+            for (size_t i = 0; i < needle.size(); ++i) {
+                int rank = byteFrequencyRank((unsigned char)needle[i]);
+                if (rank < bestRank) {
+                    bestRank = rank;
+                    rareIndex = i;
+                }
             }
-            
-            // Add all files and directories in the current directory
-            for (const auto& entry : fs::directory_iterator(currentDirectory)) {
-                entries.push_back(entry.path());
+            rareByte = needle.empty() ? 0 : needle[rareIndex];
+        }
+
+        const std::string& pattern() const { return needle; }
+        size_t size() const { return needle.size(); }
+
+        // Returns a pointer to the first occurrence in [begin, end), or `end` if there is none
+        const char* find(const char* begin, const char* end) const {
+            size_t n = needle.size();
+            if (n == 0 || (size_t)(end - begin) < n) return end;
+
+            const char* anchor = begin + rareIndex;
+            const char* lastAnchor = end - n + rareIndex + 1;  // Exclusive bound for the anchor byte
+            while (anchor < lastAnchor) {
+                anchor = static_cast<const char*>(std::memchr(anchor, rareByte, lastAnchor - anchor));
+                if (!anchor) return end;
+                const char* start = anchor - rareIndex;
+                if (std::memcmp(start, needle.data(), n) == 0) return start;
+                ++anchor;
             }
-            
-            // Sort entries: directories first, then files, both alphabetically
-            std::sort(entries.begin(), entries.end(), [](const fs::path& a, const fs::path& b) {
-                bool aIsDir = fs::is_directory(a);
-                bool bIsDir = fs::is_directory(b);
-                
-                if (aIsDir && !bIsDir) return true;
-                if (!aIsDir && bIsDir) return false;
-                
-                return a.filename().string() < b.filename().string();
-            });
-            
-            // Reset selection if out of bounds
-            if (selectedIndex >= static_cast<int>(entries.size())) {
-                selectedIndex = std::max(0, static_cast<int>(entries.size()) - 1);
+            return end;
+        }
+
+        // Appends the start column of every non-overlapping occurrence in `text`
+        void findAll(const std::string& text, std::vector<int>& out) const {
+            const char* begin = text.data();
+            const char* end = begin + text.size();
+            for (const char* p = find(begin, end); p != end; p = find(p + needle.size(), end)) {
+                out.push_back((int)(p - begin));
             }
-            
-            // Adjust scroll offset if necessary
-            if (selectedIndex < scrollOffset) {
-                scrollOffset = selectedIndex;
-            } else if (selectedIndex >= scrollOffset + screenRows - 1) {
-                scrollOffset = selectedIndex - (screenRows - 1) + 1;
+        }
+};
+
+// Per-line cache of search hits for the active query. Lines are scanned the first time they
+// are needed and only rescanned after an edit reports them as changed, so repainting or
+// scrolling over already-seen text costs no search work at all.
+class MatchIndex {
+    private:
+        LiteralSearcher searcher;
+        std::vector<std::vector<int>> hits;  // Sorted match start columns per line
+        std::vector<char> scanned;           // Whether hits[line] is up to date
+        int unscanned = 0;                   // Number of lines that still need a scan
+        int total = 0;                       // Sum of hits over all scanned lines
+
+        void scanLine(const std::vector<std::string>& lines, int row) {
+            total -= (int)hits[row].size();
+            hits[row].clear();
+            searcher.findAll(lines[row], hits[row]);
+            total += (int)hits[row].size();
+            scanned[row] = 1;
+            --unscanned;
+        }
+
+        // Keeps the cache the same length as the document; new rows start unscanned
+        void syncSize(const std::vector<std::string>& lines) {
+            if (hits.size() == lines.size()) return;
+            if (hits.size() > lines.size()) {
+                for (size_t i = lines.size(); i < hits.size(); ++i) {
+                    total -= (int)hits[i].size();
+                    if (!scanned[i]) --unscanned;
+                }
+            } else {
+                unscanned += (int)(lines.size() - hits.size());
             }
+            hits.resize(lines.size());
+            scanned.resize(lines.size(), 0);
         }
-        
+
     public:
-        FileNavigator(const std::string& initialPath, int rows, int cols) 
-            : screenRows(rows), screenCols(cols) {
-            // Initialize with the given path or current directory if path is invalid
-            try {
-                currentDirectory = fs::absolute(initialPath);
-                if (!fs::exists(currentDirectory) || !fs::is_directory(currentDirectory)) {
-                    currentDirectory = fs::current_path();
+        void setQuery(const std::string& query) {
+            if (query == searcher.pattern()) return;
+            searcher = LiteralSearcher(query);
+            reset();
+        }
+
+        int queryLength() const { return (int)searcher.size(); }
+
+        // Sorted start columns of the matches on `row`, rescanning the line only if it changed
+        const std::vector<int>& lineMatches(const std::vector<std::string>& lines, int row) {
+            syncSize(lines);
+            if (!scanned[row]) scanLine(lines, row);
+            return hits[row];
+        }
+
+        // Total number of matches in the document; after the first call only stale lines are scanned
+        int countAll(const std::vector<std::string>& lines) {
+            bool complete;
+            return countSome(lines, INT_MAX, complete);
+        }
+
+        // Like countAll, but scans at most `maxScans` stale lines; `complete` tells whether the
+        // total covers the whole document or only the lines scanned so far
+        int countSome(const std::vector<std::string>& lines, int maxScans, bool& complete) {
+            syncSize(lines);
+            for (auto it = std::find(scanned.begin(), scanned.end(), 0); unscanned > 0 && maxScans > 0 && it != scanned.end();
+                 it = std::find(it + 1, scanned.end(), 0)) {
+                scanLine(lines, (int)(it - scanned.begin()));
+                --maxScans;
+            }
+            complete = unscanned == 0;
+            return total;
+        }
+
+        void lineChanged(int row) {
+            if (row < 0 || row >= (int)scanned.size() || !scanned[row]) return;
+            scanned[row] = 0;
+            ++unscanned;
+        }
+
+        void linesInserted(int row, int count) {
+            if (row < 0 || row > (int)hits.size() || count <= 0) return;
+            hits.insert(hits.begin() + row, count, std::vector<int>());
+            scanned.insert(scanned.begin() + row, count, 0);
+            unscanned += count;
+        }
+
+        void linesErased(int row, int count) {
+            if (row < 0 || count <= 0) return;
+            count = std::min(count, (int)hits.size() - row);
+            if (count <= 0) return;
+            for (int i = row; i < row + count; ++i) {
+                total -= (int)hits[i].size();
+                if (!scanned[i]) --unscanned;
+            }
+            hits.erase(hits.begin() + row, hits.begin() + row + count);
+            scanned.erase(scanned.begin() + row, scanned.begin() + row + count);
+        }
+
+        void reset() {
+            hits.clear();
+            scanned.clear();
+            unscanned = 0;
+            total = 0;
+        }
+};
+
+// === Screen Grid ===
+
+// Writes n in decimal to `scratch` (20 chars is enough for any size_t) and returns the digit
+// count, so drawing numbers needs no temporary strings
+int formatDecimal(size_t n, char* scratch) {
+    char reversed[20];
+    int len = 0;
+    do { reversed[len++] = char('0' + n % 10); n /= 10; } while (n);
+    for (int i = 0; i < len; ++i) scratch[i] = reversed[len - 1 - i];
+    return len;
+}
+
+// Appends n in decimal; allocation-free once `out` has the capacity
+void appendDecimal(std::string& out, size_t n) {
+    char scratch[20];
+    out.append(scratch, formatDecimal(n, scratch));
+}
+
+// One character cell on screen: the byte shown and the console attribute it is drawn with
+struct Cell {
+    char glyph = ' ';
+    WORD attr = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+
+    bool operator==(const Cell& other) const { return glyph == other.glyph && attr == other.attr; }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+// A run of columns [from, to) of one line drawn with the same attribute
+struct StyleSpan {
+    int from;
+    int to;
+    WORD attr;
+};
+
+// Styling of one line as sorted, non-overlapping spans. Columns no span covers use the line's
+// base color, so a plain line is no spans at all. Overlays (watch terms, search hits, the
+// selection, a matched bracket) are merged into the spans instead of being painted cell by cell,
+// and the finished line is painted one span at a time.
+class StyleSpans {
+    private:
+        std::vector<StyleSpan> spans;
+        std::vector<StyleSpan> merged;  // Scratch for overlay(); swapped with spans afterwards
+        int clipFrom = 0;               // Visible columns; anything outside is dropped
+        int clipTo = 0;
+
+        // Appends to `out`, joining the span with the previous one when they touch and share a color
+        static void push(std::vector<StyleSpan>& out, int from, int to, WORD attr) {
+            if (from >= to) return;
+            if (!out.empty() && out.back().to == from && out.back().attr == attr) {
+                out.back().to = to;
+            } else {
+                out.push_back({ from, to, attr });
+            }
+        }
+
+    public:
+        // Starts a new line whose visible columns are [from, to)
+        void reset(int from, int to) {
+            spans.clear();
+            clipFrom = from;
+            clipTo = to;
+            // Spans never overlap, so a line has at most one per visible column: reserved once, they never grow mid-frame
+            spans.reserve(std::max(0, to - from));
+            merged.reserve(std::max(0, to - from));
+        }
+
+        const std::vector<StyleSpan>& get() const { return spans; }
+
+        // Adds a span; spans must be added left to right
+        void add(int from, int to, WORD attr) {
+            from = std::max({ from, clipFrom, spans.empty() ? clipFrom : spans.back().to });
+            push(spans, from, std::min(to, clipTo), attr);
+        }
+
+        // Recolors the columns [from, to) of every (sorted) range: combine(color) for each color
+        // already there, combine(baseAttr) for the gaps between spans
+        template <typename Combine>
+        void overlay(const std::pair<int, int>* ranges, size_t count, WORD baseAttr, Combine combine) {
+            merged.clear();
+            size_t i = 0;
+            int covered = clipFrom;
+            for (size_t r = 0; r < count; ++r) {
+                int from = std::max(ranges[r].first, covered);
+                int to = std::min(ranges[r].second, clipTo);
+                if (from >= to) continue;
+                covered = to;
+
+                // Spans entirely left of the range stay as they are; one that straddles its start is split
+                while (i < spans.size() && spans[i].to <= from) {
+                    push(merged, spans[i].from, spans[i].to, spans[i].attr);
+                    ++i;
+                }
+                if (i < spans.size() && spans[i].from < from) {
+                    push(merged, spans[i].from, from, spans[i].attr);
+                    spans[i].from = from;
+                }
+
+                // Walk the range: recolor the spans inside it and fill the gaps between them
+                for (int x = from; x < to;) {
+                    if (i < spans.size() && spans[i].from <= x) {
+                        int end = std::min(spans[i].to, to);
+                        push(merged, x, end, combine(spans[i].attr));
+                        if (spans[i].to <= to) ++i; else spans[i].from = to;
+                        x = end;
+                    } else {
+                        int end = (i < spans.size()) ? std::min(spans[i].from, to) : to;
+                        push(merged, x, end, combine(baseAttr));
+                        x = end;
+                    }
                 }
-            } catch (...) {
-                currentDirectory = fs::current_path();
             }
-            
-            refreshEntries();
+            for (; i < spans.size(); ++i) push(merged, spans[i].from, spans[i].to, spans[i].attr);
+            spans.swap(merged);
+        }
+
+        template <typename Combine>
+        void overlay(int from, int to, WORD baseAttr, Combine combine) {
+            std::pair<int, int> range(from, to);
+            overlay(&range, 1, baseAttr, combine);
+        }
+};
+
+// === Terminal Backend ===
+
+// readKey() result when the window changed size; getSize() already reports the new size
+const int KEY_RESIZE = 256;
+
+// Everything the editor needs from the terminal. Keys come back as _getch()-style codes
+// (224 followed by the scan code for arrows, Home, End, Page Up/Down) on every platform.
+class TerminalBackend {
+    public:
+        virtual ~TerminalBackend() = default;
+
+        // The window size as of the last resize event; cheap, it does not ask the system. Both are
+        // called on the editor thread only; the drawing side learns the size from beginFrame().
+        virtual void getSize(int& rows, int& cols) = 0;
+        virtual void refreshSize() {}  // Asks the system again, in case a resize went unreported
+
+        // Queues `count` cells starting at (row, col). `shownRow` is the whole row as it is on
+        // screen right now, which a backend may reuse to move the cursor by rewriting cells.
+        virtual void writeCells(int row, int col, const Cell* cells, int count, const Cell* shownRow) = 0;
+        virtual void setCursor(int row, int col) = 0;
+        virtual void beginFrame(int rows, int cols) { (void)rows; (void)cols; } // Starts a frame of this size; the next flush() ends it
+        virtual void flush() = 0;    // Sends everything queued since the last flush
+        virtual void forget() {}     // Something else wrote to the screen: drop cached cursor/color state
+        virtual void frameStarting() {} // The editor starts on the work for its next frame (the headless target times frames from here)
+        virtual void clear() = 0;    // Blanks the screen (used on quit)
+
+        // Switches the look of the 16 console colors to the theme's; entries of -1 go back to the
+        // terminal's own. Called rarely (theme loads), so backends prepare everything here.
+        virtual void setPalette(const Palette& palette) { (void)palette; }
+
+        // Moves the contents of rows [top, bottom) up by `delta` rows (down if negative) without
+        // resending them. Returns false if the backend cannot; the rows are then simply redrawn.
+        virtual bool scrollRows(int top, int bottom, int delta, int width) { (void)top; (void)bottom; (void)delta; (void)width; return false; }
+
+        virtual int readKey() = 0;   // Blocks until a key is available
+        virtual bool keyAvailable() = 0;
+        virtual bool ctrlHeld() = 0; // Modifier state of the key last returned by readKey()
+        virtual bool shiftHeld() = 0;
+};
+
+// ANSI/VT output shared by the POSIX terminal and the headless target. A frame is assembled in
+// one string, and the cursor position and current colors are tracked so every move and color
+// change uses the fewest bytes. Subclasses decide where the bytes go in flush().
+class AnsiOutput : public TerminalBackend {
+    protected:
+        std::string out;                 // Bytes queued for the next flush()
+        int rows = 24;                   // Window size, kept by the editor thread (getSize/refreshSize)
+        int cols = 80;
+        int frameCols = 80;              // Width of the frame being drawn, kept by the drawing thread
+        int cursorRow = -1;              // Where the terminal's cursor is (-1 = unknown)
+        int cursorCol = -1;
+        int currentAttr = -1;            // Attribute the terminal is drawing with (-1 = unknown)
+        bool synchronizedOutput = false; // Terminal supports DEC mode 2026 (synchronized update)
+        bool inFrame = false;
+
+        // Color escape codes, compiled whenever the palette changes so drawing only copies bytes
+        enum ColorDepth { COLORS_16, COLORS_256, TRUECOLOR } colorDepth = COLORS_16;
+        std::array<std::string, 16> foregroundCodes;  // "\x1b[<fg>m" for each console color
+        std::array<std::string, 16> backgroundCodes;  // "\x1b[<bg>m"
+        std::array<std::string, 256> colorCodes;      // "\x1b[<fg>;<bg>m" for each attribute's color byte
+
+        static int digits(int n) { return n < 10 ? 1 : n < 100 ? 2 : n < 1000 ? 3 : 4; }
+
+        void appendNumber(int n) {
+            char scratch[12];
+            int len = 0;
+            do { scratch[len++] = char('0' + n % 10); n /= 10; } while (n);
+            while (len) out += scratch[--len];
+        }
+
+        // ANSI color number (0-7) for the red/green/blue bits of a console attribute nibble
+        static int ansiColor(int bits) {
+            return ((bits & FOREGROUND_RED) ? 1 : 0) | ((bits & FOREGROUND_GREEN) ? 2 : 0) | ((bits & FOREGROUND_BLUE) ? 4 : 0);
+        }
+
+        // SGR parameters for console color `index` (0-15) as a foreground or background. Palette
+        // colors go out as 24-bit codes, or as the nearest 256-color index on terminals without truecolor.
+        std::string colorParameters(const Palette& palette, int index, bool background) const {
+            int rgb = palette.rgb[index];
+            std::string parameters;
+            if (rgb >= 0 && colorDepth == TRUECOLOR) {
+                parameters = (background ? "48;2;" : "38;2;") + std::to_string((rgb >> 16) & 0xFF) + ';' +
+                             std::to_string((rgb >> 8) & 0xFF) + ';' + std::to_string(rgb & 0xFF);
+            } else if (rgb >= 0 && colorDepth == COLORS_256) {
+                parameters = (background ? "48;5;" : "38;5;") + std::to_string(nearestXtermColor(rgb));
+            } else {
+                int base = (index & FOREGROUND_INTENSITY) ? (background ? 100 : 90) : (background ? 40 : 30);
+                parameters = std::to_string(base + ansiColor(index));
+            }
+            return parameters;
+        }
+
+        void compileColors(const Palette& palette) {
+            std::array<std::string, 16> foreground, background;
+            for (int i = 0; i < 16; ++i) {
+                foreground[i] = colorParameters(palette, i, false);
+                background[i] = colorParameters(palette, i, true);
+                foregroundCodes[i] = "\x1b[" + foreground[i] + 'm';
+                backgroundCodes[i] = "\x1b[" + background[i] + 'm';
+            }
+            for (int attr = 0; attr < 256; ++attr) {
+                colorCodes[attr] = "\x1b[" + foreground[attr & 0x0F] + ';' + background[attr >> 4] + 'm';
+            }
+            currentAttr = -1;  // Whatever is on screen was set with the old codes
+        }
+
+        // Switches colors, emitting only the parts (foreground/background) that actually change
+        void setAttr(WORD attr) {
+            if (currentAttr == attr) return;
+            int fg = attr & 0x0F;
+            int bg = (attr >> 4) & 0x0F;
+            bool fgChanged = currentAttr < 0 || fg != (currentAttr & 0x0F);
+            bool bgChanged = currentAttr < 0 || bg != ((currentAttr >> 4) & 0x0F);
+
+            if (fgChanged && bgChanged) out += colorCodes[attr & 0xFF];
+            else if (fgChanged) out += foregroundCodes[fg];
+            else if (bgChanged) out += backgroundCodes[bg];
+            currentAttr = attr;
+        }
+
+        // Cost in bytes of a relative horizontal move from fromCol to toCol on the current row
+        int horizontalCost(int fromCol, int toCol, const Cell* shownRow) const {
+            if (toCol == fromCol) return 0;
+            int relative = 3 + (std::abs(toCol - fromCol) > 1 ? digits(std::abs(toCol - fromCol)) : 0);  // CUF / CUB
+            if (toCol > fromCol && shownRow && rewritable(fromCol, toCol, shownRow)) {
+                relative = std::min(relative, toCol - fromCol);  // Reprint the cells in between
+            }
+            return relative;
+        }
+
+        bool rewritable(int fromCol, int toCol, const Cell* shownRow) const {
+            for (int x = fromCol; x < toCol; ++x) {
+                if (shownRow[x].attr != currentAttr) return false;
+            }
+            return true;
+        }
+
+        void moveHorizontally(int fromCol, int toCol, const Cell* shownRow) {
+            int distance = std::abs(toCol - fromCol);
+            if (distance == 0) return;
+            int escapeCost = 3 + (distance > 1 ? digits(distance) : 0);
+            if (toCol > fromCol && shownRow && distance <= escapeCost && rewritable(fromCol, toCol, shownRow)) {
+                for (int x = fromCol; x < toCol; ++x) out += shownRow[x].glyph;
+                return;
+            }
+            out += "\x1b[";
+            if (distance > 1) appendNumber(distance);
+            out += toCol > fromCol ? 'C' : 'D';
+        }
+
+        // Picks the cheapest of: absolute CUP, relative up/down/left/right, or carriage return
+        // plus a move right. Relative moves need a known cursor position.
+        void moveTo(int row, int col, const Cell* shownRow) {
+            if (row == cursorRow && col == cursorCol) return;
+
+            int absoluteCost = (row == 0 && col == 0) ? 3 : 4 + digits(row + 1) + digits(col + 1);
+            int best = absoluteCost;
+            enum { ABSOLUTE, RELATIVE, RETURN } plan = ABSOLUTE;
+
+            if (cursorRow >= 0) {
+                int rowDistance = std::abs(row - cursorRow);
+                int verticalCost = rowDistance == 0 ? 0 : 3 + (rowDistance > 1 ? digits(rowDistance) : 0);
+                const Cell* sameRow = row == cursorRow ? shownRow : nullptr;  // Reprinting only works on the row we stay on
+
+                if (cursorCol >= 0) {
+                    int relativeCost = verticalCost + horizontalCost(cursorCol, col, sameRow);
+                    if (relativeCost < best) { best = relativeCost; plan = RELATIVE; }
+                }
+                int returnCost = 1 + verticalCost + horizontalCost(0, col, sameRow);
+                if (returnCost < best) { best = returnCost; plan = RETURN; }
+            }
+
+            if (plan == ABSOLUTE) {
+                out += "\x1b[";
+                if (row != 0 || col != 0) {
+                    appendNumber(row + 1);
+                    out += ';';
+                    appendNumber(col + 1);
+                }
+                out += 'H';
+            } else {
+                const Cell* sameRow = row == cursorRow ? shownRow : nullptr;
+                int fromCol = cursorCol;
+                if (plan == RETURN) {
+                    out += '\r';
+                    fromCol = 0;
+                }
+                if (row != cursorRow) {
+                    out += "\x1b[";
+                    if (std::abs(row - cursorRow) > 1) appendNumber(std::abs(row - cursorRow));
+                    out += row > cursorRow ? 'B' : 'A';
+                }
+                moveHorizontally(fromCol, col, sameRow);
+            }
+            cursorRow = row;
+            cursorCol = col;
+        }
+
+        // Ends the frame bracket opened by beginFrame(); returns false if no frame was open
+        bool closeFrame() {
+            if (!inFrame) return false;
+            out += synchronizedOutput ? "\x1b[?2026l" : "\x1b[?25h";
+            inFrame = false;
+            return true;
+        }
+
+    public:
+        void setPalette(const Palette& palette) override {
+            compileColors(palette);
+        }
+
+        void writeCells(int row, int col, const Cell* cells, int count, const Cell* shownRow) override {
+            moveTo(row, col, shownRow);
+            for (int i = 0; i < count; ++i) {
+                setAttr(cells[i].attr);
+                out += cells[i].glyph;
+            }
+            cursorCol = col + count;
+            if (cursorCol >= frameCols) cursorCol = -1;  // Pending wrap at the right margin: the column is unreliable
+        }
+
+        void setCursor(int row, int col) override {
+            moveTo(row, col, nullptr);
+        }
+
+        // Frames are bracketed so the terminal shows them atomically: a synchronized update where
+        // supported, otherwise the cursor is hidden until the frame is complete
+        void beginFrame(int, int frameWidth) override {
+            frameCols = frameWidth;
+            out += synchronizedOutput ? "\x1b[?2026h" : "\x1b[?25l";
+            inFrame = true;
+        }
+
+        void forget() override {
+            cursorRow = cursorCol = -1;
+            currentAttr = -1;
+        }
+
+        // DECSTBM limits scrolling to the region, then SU/SD shift it. Resetting the region homes
+        // the cursor, so its position is unknown afterwards.
+        bool scrollRows(int top, int bottom, int delta, int) override {
+            out += "\x1b[";
+            appendNumber(top + 1);
+            out += ';';
+            appendNumber(bottom);
+            out += "r\x1b[";
+            if (std::abs(delta) > 1) appendNumber(std::abs(delta));
+            out += delta > 0 ? 'S' : 'T';
+            out += "\x1b[r";
+            cursorRow = cursorCol = -1;
+            return true;
+        }
+};
+
+#ifdef _WIN32
+// Windows console: cells go straight into the screen buffer with WriteConsoleOutputA
+class WinConsoleTerminal : public TerminalBackend {
+    private:
+        HANDLE hOut;
+        HANDLE hIn;
+        DWORD originalInputMode = 0;
+        int rows = 25;                     // Window size, updated on buffer-size events (editor thread)
+        int cols = 80;
+        int bufferRows = 0;                // Screen buffer size, matched to each frame (drawing thread)
+        int bufferCols = 0;
+        bool resized = false;              // A buffer-size event arrived and readKey() has not reported it yet
+        bool midKey = false;               // _getch() returned 0 or 224; the scan code is still buffered
+        std::vector<CHAR_INFO> runBuffer;  // Scratch space for the cells of one run
+        CONSOLE_CURSOR_INFO cursorInfo;    // The user's cursor shape, restored after each frame
+        bool inFrame = false;
+        COLORREF originalColors[16];       // The console's color table before a theme changed it
+        bool colorsChanged = false;
+
+    public:
+        WinConsoleTerminal() {
+            hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+
+            // Set the console's output code page to UTF-8 for proper handling of Unicode characters
+            SetConsoleOutputCP(65001);
+
+            // Enable VT100 terminal sequences (this is for supporting advanced text formatting and colors in the console)
+            DWORD dwMode = 0;
+            GetConsoleMode(hOut, &dwMode);
+            dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+            SetConsoleMode(hOut, dwMode);
+
+            // Have the console queue an event whenever the screen buffer changes size
+            hIn = GetStdHandle(STD_INPUT_HANDLE);
+            GetConsoleMode(hIn, &originalInputMode);
+            SetConsoleMode(hIn, originalInputMode | ENABLE_WINDOW_INPUT);
+
+            refreshSize();
+            GetConsoleCursorInfo(hOut, &cursorInfo);
+        }
+
+        ~WinConsoleTerminal() override {
+            if (colorsChanged) setPalette(Palette());  // The color table outlives the program, so put it back
+            SetConsoleMode(hIn, originalInputMode);
+        }
+
+        void getSize(int& screenRows, int& screenCols) override {
+            screenRows = rows;
+            screenCols = cols;
+        }
+
+        // Reads the window size. The screen buffer is matched to it in beginFrame(), on the thread
+        // that writes cells, so it never changes size under a frame being drawn.
+        void refreshSize() override {
+            CONSOLE_SCREEN_BUFFER_INFO csbi;
+            if (!GetConsoleScreenBufferInfo(hOut, &csbi)) return;
+            cols = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+            rows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+        }
+
+        void writeCells(int row, int col, const Cell* cells, int count, const Cell*) override {
+            runBuffer.resize(count);
+            for (int i = 0; i < count; ++i) {
+                runBuffer[i].Char.AsciiChar = cells[i].glyph;
+                runBuffer[i].Attributes = cells[i].attr;
+            }
+            SMALL_RECT region = { (SHORT)col, (SHORT)row, (SHORT)(col + count - 1), (SHORT)row };
+            WriteConsoleOutputA(hOut, runBuffer.data(), { (SHORT)count, 1 }, { 0, 0 }, &region);
+        }
+
+        void setCursor(int row, int col) override {
+            SetConsoleCursorPosition(hOut, { (SHORT)col, (SHORT)row });
+        }
+
+        // The console has no synchronized updates; hiding the cursor keeps it from flickering
+        // across the screen while the runs of a frame are written. A frame of a new size first
+        // matches the screen buffer to it so nothing scrolls off.
+        void beginFrame(int frameRows, int frameCols) override {
+            if (frameRows != bufferRows || frameCols != bufferCols) {
+                bufferRows = frameRows;
+                bufferCols = frameCols;
+                SetConsoleScreenBufferSize(hOut, { static_cast<SHORT>(frameCols), static_cast<SHORT>(frameRows) });
+            }
+            CONSOLE_CURSOR_INFO hidden = cursorInfo;
+            hidden.bVisible = FALSE;
+            SetConsoleCursorInfo(hOut, &hidden);
+            inFrame = true;
+        }
+
+        void flush() override {  // Console writes are immediate; only the cursor needs restoring
+            if (!inFrame) return;
+            SetConsoleCursorInfo(hOut, &cursorInfo);
+            inFrame = false;
+        }
+
+        void clear() override { system("cls"); }
+
+        // The console has exactly 16 colors, so a theme palette simply replaces its color table
+        void setPalette(const Palette& palette) override {
+            CONSOLE_SCREEN_BUFFER_INFOEX info;
+            info.cbSize = sizeof(info);
+            if (!GetConsoleScreenBufferInfoEx(hOut, &info)) return;
+            if (!colorsChanged) std::copy(info.ColorTable, info.ColorTable + 16, originalColors);
+            for (int i = 0; i < 16; ++i) {
+                int rgb = palette.rgb[i];
+                info.ColorTable[i] = rgb < 0 ? originalColors[i] : RGB((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+            }
+            // The Set call takes the window as exclusive while Get returns it inclusive; without this the window shrinks
+            ++info.srWindow.Right;
+            ++info.srWindow.Bottom;
+            colorsChanged = SetConsoleScreenBufferInfoEx(hOut, &info) != 0 || colorsChanged;
+        }
+
+        bool scrollRows(int top, int bottom, int delta, int width) override {
+            SMALL_RECT region = { 0, (SHORT)top, (SHORT)(width - 1), (SHORT)(bottom - 1) };
+            SMALL_RECT moved = region;
+            if (delta > 0) moved.Top = (SHORT)(top + delta);
+            else moved.Bottom = (SHORT)(bottom - 1 + delta);
+            COORD destination = { 0, (SHORT)(delta > 0 ? top : top - delta) };
+            CHAR_INFO fill;
+            fill.Char.AsciiChar = ' ';
+            fill.Attributes = Cell().attr;
+            return ScrollConsoleScreenBufferA(hOut, &moved, &region, destination, &fill) != 0;
+        }
+
+        // Whether _getch() returns anything for this key press: a character, or 0/224 followed by
+        // a scan code for the keys it knows (arrows, Home/End, Page Up/Down, Insert/Delete, F1-F12).
+        // Modifiers, Caps Lock, Num Lock, the Windows key and the like produce nothing.
+        static bool getchReturns(const KEY_EVENT_RECORD& key) {
+            if (key.uChar.AsciiChar != 0) return true;
+            WORD code = key.wVirtualKeyCode;
+            return (code >= VK_PRIOR && code <= VK_DOWN) || code == VK_INSERT || code == VK_DELETE ||
+                   (code >= VK_F1 && code <= VK_F12);
+        }
+
+        // _getch() silently throws away everything that is not a key press, so the records at the
+        // front of the input queue are looked at first: buffer-size events are noted here, other
+        // records (key-ups, focus changes, keys _getch() would skip) are dropped. Returns true if a
+        // key press _getch() returns is next in the queue, so readKey() never blocks on a dropped one.
+        bool takeNonKeyEvents() {
+            INPUT_RECORD record;
+            DWORD count = 0;
+            while (PeekConsoleInputA(hIn, &record, 1, &count) && count == 1) {
+                if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown && getchReturns(record.Event.KeyEvent)) {
+                    return true;
+                }
+                ReadConsoleInputA(hIn, &record, 1, &count);
+                if (record.EventType == WINDOW_BUFFER_SIZE_EVENT) {
+                    refreshSize();
+                    resized = true;
+                }
+            }
+            return false;
+        }
+
+        int readKey() override {
+            if (midKey) {  // Second half of a two-code key: already read by the CRT
+                midKey = false;
+                return _getch();
+            }
+            while (!takeNonKeyEvents() && !resized) {
+                WaitForSingleObject(hIn, INFINITE);  // Wakes on key presses and buffer-size events alike
+            }
+            if (resized) {
+                resized = false;
+                return KEY_RESIZE;
+            }
+            int c = _getch();
+            midKey = c == 0 || c == 224;
+            return c;
+        }
+
+        bool keyAvailable() override {
+            if (midKey || resized) return true;
+            return takeNonKeyEvents() || resized;
+        }
+
+        bool ctrlHeld() override { return GetKeyState(VK_CONTROL) < 0; }
+        bool shiftHeld() override { return GetKeyState(VK_SHIFT) < 0; }
+};
+#else
+// Self-pipe for SIGWINCH: the handler only writes a byte, which wakes the poll() waiting for keys
+int resizePipe[2] = { -1, -1 };
+
+void onWindowResize(int) {
+    int savedErrno = errno;
+    char byte = 0;
+    if (write(resizePipe[1], &byte, 1) < 0) {}  // Pipe full: a resize is already pending
+    errno = savedErrno;
+}
+
+// POSIX terminals (Linux consoles, xterm-likes, SSH sessions): termios raw mode, keys decoded
+// from escape sequences, and each frame sent with a single write()
+class AnsiTerminal : public AnsiOutput {
+    private:
+        termios original{};
+        bool rawMode = false;
+        std::deque<int> pendingKeys;     // Second halves of two-code keys (224, scan code)
+        std::string typeahead;           // Keys that arrived while waiting for a terminal reply
+        bool lastCtrl = false;
+        bool lastShift = false;
+        bool resized = false;            // SIGWINCH arrived and readKey() has not reported it yet
+        struct sigaction originalResizeAction{};
+
+        static const int RESIZED = -2;   // readByte(): the wait ended because of a resize
+
+        // Empties the self-pipe and takes the new window size
+        void takeResize() {
+            char drain[64];
+            while (read(resizePipe[0], drain, sizeof(drain)) > 0) {}
+            refreshSize();
+            resized = true;
+        }
+
+        // How much color the terminal advertises. Truecolor terminals set COLORTERM; 256-color
+        // ones say so in TERM. Anything else gets the classic 16 colors and ignores palettes.
+        static ColorDepth detectColorDepth() {
+            const char* colorTerm = getenv("COLORTERM");
+            if (colorTerm && (std::strcmp(colorTerm, "truecolor") == 0 || std::strcmp(colorTerm, "24bit") == 0)) return TRUECOLOR;
+            const char* term = getenv("TERM");
+            if (term && std::strstr(term, "256color")) return COLORS_256;
+            return COLORS_16;
+        }
+
+        // Reads one byte, waiting at most timeoutMs (-1 = forever); returns -1 on timeout. A wait
+        // without a timeout also ends on a window resize, returning RESIZED.
+        int readByte(int timeoutMs) {
+            if (!typeahead.empty()) {
+                unsigned char byte = typeahead.front();
+                typeahead.erase(0, 1);
+                return byte;
+            }
+            while (true) {
+                pollfd inputs[2] = { { STDIN_FILENO, POLLIN, 0 }, { resizePipe[0], POLLIN, 0 } };
+                int ready = poll(inputs, resizePipe[0] >= 0 ? 2 : 1, timeoutMs);
+                if (ready < 0 && errno == EINTR) continue;  // Interrupted by SIGWINCH; the pipe now has its byte
+                if (ready <= 0) return -1;
+                if (inputs[1].revents & POLLIN) {
+                    takeResize();
+                    if (timeoutMs < 0) return RESIZED;
+                    continue;  // Mid escape sequence: finish the key first
+                }
+                unsigned char byte;
+                return read(STDIN_FILENO, &byte, 1) == 1 ? byte : -1;
+            }
+        }
+
+        // Asks whether the terminal supports synchronized output. DECRQM for mode 2026 is sent
+        // together with a primary device attributes request, which every terminal answers: if the
+        // DA reply arrives without a DECRQM reply first, the mode is unknown. Anything else that
+        // arrives meanwhile is keyboard input and is kept for readKey().
+        void detectSynchronizedOutput() {
+            out += "\x1b[?2026$p\x1b[c";
+            flush();
+
+            std::string reply;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+            size_t attributes = std::string::npos;
+            while (attributes == std::string::npos) {
+                int waitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (waitMs <= 0) break;
+                pollfd input = { STDIN_FILENO, POLLIN, 0 };
+                if (poll(&input, 1, waitMs) <= 0) break;
+                char chunk[256];
+                ssize_t n = read(STDIN_FILENO, chunk, sizeof(chunk));
+                if (n <= 0) break;
+                reply.append(chunk, (size_t)n);
+
+                // DA reply: ESC [ ? <digits and ;> c
+                for (size_t at = reply.find("\x1b[?"); at != std::string::npos; at = reply.find("\x1b[?", at + 1)) {
+                    size_t end = reply.find_first_not_of("0123456789;", at + 3);
+                    if (end != std::string::npos && reply[end] == 'c') {
+                        attributes = at;
+                        reply.erase(at, end + 1 - at);
+                        break;
+                    }
+                }
+            }
+
+            // DECRQM reply: ESC [ ? 2026 ; <state> $ y, where state 1 (set) or 2 (reset) means supported
+            const std::string modeReply = "\x1b[?2026;";
+            size_t at = reply.find(modeReply);
+            if (at != std::string::npos && reply.compare(at + modeReply.size() + 1, 2, "$y") == 0) {
+                char state = reply[at + modeReply.size()];
+                synchronizedOutput = state == '1' || state == '2';
+                reply.erase(at, modeReply.size() + 3);
+            }
+            typeahead += reply;
+        }
+
+        // Decodes the rest of an escape sequence into a scan code; 0 if it is not a key we use
+        int decodeEscape() {
+            int first = readByte(25);  // A lone Esc is not followed by anything
+            if (first != '[' && first != 'O') {
+                if (first >= 0) typeahead.insert(typeahead.begin(), (char)first);  // A key typed right after Esc, or pasted text
+                return 0;
+            }
+
+            int params[2] = { 0, 0 };
+            int count = 0;
+            int final = readByte(25);
+            while (final >= 0 && ((final >= '0' && final <= '9') || final == ';')) {
+                if (final == ';') {
+                    count = std::min(count + 1, 1);
+                } else {
+                    params[count] = std::min(params[count] * 10 + (final - '0'), 9999);  // No key uses more; stops overflow
+                }
+                final = readByte(25);
+            }
+
+            // xterm modifier parameter: 1 + (shift ? 1) + (alt ? 2) + (ctrl ? 4)
+            int modifiers = params[1] > 0 ? params[1] - 1 : 0;
+            lastShift = modifiers & 1;
+            lastCtrl = modifiers & 4;
+
+            switch (final) {
+                case 'A': return 72;  // Up
+                case 'B': return 80;  // Down
+                case 'C': return 77;  // Right
+                case 'D': return 75;  // Left
+                case 'H': return 71;  // Home
+                case 'F': return 79;  // End
+                case '~':
+                    switch (params[0]) {
+                        case 1: case 7: return 71;  // Home
+                        case 4: case 8: return 79;  // End
+                        case 3: return 83;          // Delete
+                        case 5: return 73;          // Page Up
+                        case 6: return 81;          // Page Down
+                    }
+                    return 0;
+            }
+            return 0;
+        }
+
+    public:
+        AnsiTerminal() {
+            if (tcgetattr(STDIN_FILENO, &original) == 0) {
+                termios raw = original;
+                raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);  // Ctrl+S/Ctrl+Q reach the editor, Enter stays '\r'
+                raw.c_oflag &= ~(OPOST);
+                raw.c_cflag |= CS8;
+                raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);           // Ctrl+C/Ctrl+Z/Ctrl+V are editor keys
+                raw.c_cc[VMIN] = 1;
+                raw.c_cc[VTIME] = 0;
+                rawMode = tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+            }
+            out += "\x1b[?1049h\x1b[2J";  // Alternate screen, cleared
+            flush();
+            if (rawMode) detectSynchronizedOutput();
+            colorDepth = detectColorDepth();
+            compileColors(Palette());
+
+            // Hear about window resizes through the input wait instead of asking on every frame
+            if (pipe(resizePipe) == 0) {
+                for (int fd : resizePipe) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                struct sigaction action{};
+                action.sa_handler = onWindowResize;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGWINCH, &action, &originalResizeAction);
+            }
+            refreshSize();
+        }
+
+        ~AnsiTerminal() override {
+            out += "\x1b[0m\x1b[?25h\x1b[?1049l";  // Default colors, visible cursor, back to the normal screen
+            flush();
+            if (rawMode) tcsetattr(STDIN_FILENO, TCSAFLUSH, &original);
+            if (resizePipe[0] >= 0) {
+                sigaction(SIGWINCH, &originalResizeAction, nullptr);
+                close(resizePipe[0]);
+                close(resizePipe[1]);
+                resizePipe[0] = resizePipe[1] = -1;
+            }
+        }
+
+        void getSize(int& screenRows, int& screenCols) override {
+            screenRows = rows;
+            screenCols = cols;
+        }
+
+        void refreshSize() override {
+            winsize size{};
+            if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+                rows = size.ws_row;
+                cols = size.ws_col;
+            }
+        }
+
+        void flush() override {
+            closeFrame();
+            std::cout.flush();  // Anything printed through iostreams goes first
+            size_t sent = 0;
+            while (sent < out.size()) {
+                ssize_t n = write(STDOUT_FILENO, out.data() + sent, out.size() - sent);
+                if (n <= 0) break;
+                sent += (size_t)n;
+            }
+            out.clear();
+        }
+
+        void clear() override {
+            out += "\x1b[0m\x1b[2J\x1b[H";
+            flush();
+            forget();
+        }
+
+        int readKey() override {
+            if (!pendingKeys.empty()) {
+                int key = pendingKeys.front();
+                pendingKeys.pop_front();
+                return key;
+            }
+            std::cout.flush();  // Prompts printed with std::cout must be visible before we block
+
+            int byte = resized ? RESIZED : readByte(-1);
+            lastCtrl = false;
+            lastShift = false;
+            if (byte == RESIZED) {
+                resized = false;
+                return KEY_RESIZE;
+            }
+            if (byte == 27) {
+                int scanCode = decodeEscape();
+                if (scanCode == 0) return 27;
+                pendingKeys.push_back(scanCode);
+                return 224;
+            }
+            if (byte == 127) return 8;  // Backspace sends DEL on most terminals
+            if (byte == 8 || (byte >= 1 && byte <= 26 && byte != '\t' && byte != '\r')) lastCtrl = true;  // Ctrl+letter
+            return byte;
+        }
+
+        bool keyAvailable() override {
+            if (!pendingKeys.empty() || !typeahead.empty() || resized) return true;
+            pollfd inputs[2] = { { STDIN_FILENO, POLLIN, 0 }, { resizePipe[0], POLLIN, 0 } };
+            if (poll(inputs, resizePipe[0] >= 0 ? 2 : 1, 0) <= 0) return false;
+            if (inputs[1].revents & POLLIN) takeResize();
+            return true;
+        }
+
+        bool ctrlHeld() override { return lastCtrl; }
+        bool shiftHeld() override { return lastShift; }
+};
+#endif
+
+// Draws into an in-memory cell grid instead of a terminal, so frames can be rendered, timed and
+// compared without a console (render benchmarks, golden frames on a CI box). The bytes it counts
+// are exactly the ones AnsiTerminal would send. Keys come from a script given up front; once it
+// runs out the editor gets Esc and Ctrl+Q in turn, which leaves any browser or prompt and quits.
+// The screen and the stats stop changing at that point, so they show where the script ended.
+class HeadlessTerminal : public AnsiOutput {
+    public:
+        struct FrameStats {
+            double milliseconds;  // Since the previous frame ended: handling the key, drawing and presenting
+            size_t bytes;         // Bytes a terminal would have been sent
+            int cellsWritten;     // Cells handed to the backend, short clean gaps between runs included
+            int cellsChanged;     // Of those, cells that now look different
+        };
+
+    private:
+        struct ScriptedKey {
+            int code;
+            bool ctrl;
+            bool shift;
+            int rows = 0;                 // New window size for KEY_RESIZE
+            int cols = 0;
+        };
+        std::deque<ScriptedKey> keys;
+        bool lastCtrl = false;
+        bool lastShift = false;
+        bool scriptDone = false;
+        bool quitWithEscape = true;       // Which of Esc / Ctrl+Q goes next once the script is done
+        std::vector<Cell> grid;           // What the screen shows
+        int shownCursorRow = -1;          // Where the last frame put the cursor (-1 = it did not)
+        int shownCursorCol = -1;
+        std::vector<FrameStats> frames;
+        FrameStats current = {};
+        std::chrono::steady_clock::time_point frameStart;
+        bool frameTimed = true;           // frameStart is set for the next frame (the first one is timed from startup)
+
+    public:
+        HeadlessTerminal(int screenRows, int screenCols) {
+            rows = screenRows;
+            cols = screenCols;
+            grid.assign((size_t)rows * cols, Cell());
+            synchronizedOutput = true;  // Model a current terminal; the 16 classic colors keep byte counts stable
+            compileColors(Palette());
+            frameStart = std::chrono::steady_clock::now();
+        }
+
+        // Queues the keys of a script. Plain characters type themselves; <name> or <name*count>
+        // is a special key, e.g. "<down*20>hello<C-s>". Names: up, down, left, right, home, end,
+        // pgup, pgdn, del, enter, esc, bs, tab and lt (a literal '<'). A C- or S- prefix holds
+        // Ctrl or Shift, and C-<letter> is that control key. <size RxC> resizes the window.
+        // Returns false on an unknown name.
+        bool addKeys(const std::string& script, std::string& error) {
+            static const std::unordered_map<std::string, int> scanCodes = {
+                { "up", 72 }, { "down", 80 }, { "left", 75 }, { "right", 77 }, { "home", 71 },
+                { "end", 79 }, { "pgup", 73 }, { "pgdn", 81 }, { "del", 83 }
+            };
+            static const std::unordered_map<std::string, int> plainKeys = {
+                { "enter", '\r' }, { "esc", 27 }, { "bs", 8 }, { "tab", '\t' }, { "lt", '<' }
+            };
+
+            for (size_t i = 0; i < script.size(); ++i) {
+                if (script[i] != '<') {
+                    int c = script[i] == '\n' ? '\r' : (unsigned char)script[i];
+                    keys.push_back({ c, c >= 1 && c <= 26 && c != '\t' && c != '\r', false });
+                    continue;
+                }
+                size_t close = script.find('>', i);
+                if (close == std::string::npos) {
+                    error = "unterminated key name at offset " + std::to_string(i);
+                    return false;
+                }
+                std::string name = script.substr(i + 1, close - i - 1);
+                i = close;
+
+                if (name.compare(0, 5, "size ") == 0) {
+                    size_t x = name.find('x');
+                    int newRows = std::atoi(name.c_str() + 5);
+                    int newCols = x == std::string::npos ? 0 : std::atoi(name.c_str() + x + 1);
+                    if (newRows < 2 || newCols < 10) {
+                        error = "bad window size <" + name + ">";
+                        return false;
+                    }
+                    keys.push_back({ KEY_RESIZE, false, false, newRows, newCols });
+                    continue;
+                }
+
+                int count = 1;
+                size_t star = name.find('*');
+                if (star != std::string::npos) {
+                    count = std::atoi(name.c_str() + star + 1);
+                    name.erase(star);
+                }
+                bool ctrl = false, shift = false;
+                while (name.size() > 2 && name[1] == '-' && (name[0] == 'C' || name[0] == 'S')) {
+                    (name[0] == 'C' ? ctrl : shift) = true;
+                    name.erase(0, 2);
+                }
+
+                for (int n = 0; n < count; ++n) {
+                    if (scanCodes.count(name)) {
+                        keys.push_back({ 224, ctrl, shift });
+                        keys.push_back({ scanCodes.at(name), ctrl, shift });
+                    } else if (plainKeys.count(name)) {
+                        keys.push_back({ plainKeys.at(name), ctrl, shift });
+                    } else if (ctrl && name.size() == 1 && std::isalpha((unsigned char)name[0])) {
+                        keys.push_back({ std::tolower((unsigned char)name[0]) - 'a' + 1, true, shift });
+                    } else {
+                        error = "unknown key <" + name + ">";
+                        return false;
+                    }
+                }
+            }
+            frames.reserve(keys.size() + 64);  // About a frame per key; growing the log mid-run would count against a frame
+            return true;
+        }
+
+        const std::vector<FrameStats>& frameStats() const { return frames; }
+
+        // Writes what the screen shows: the text rows, the cursor, then every cell's attribute as two hex digits
+        void writeScreen(std::ostream& os) const {
+            for (int y = 0; y < rows; ++y) {
+                std::string line;
+                for (int x = 0; x < cols; ++x) line += grid[(size_t)y * cols + x].glyph;
+                os << line << '\n';
+            }
+            if (shownCursorRow >= 0) os << "-- cursor " << shownCursorRow << ',' << shownCursorCol << '\n';
+            else os << "-- cursor not placed\n";
+            os << "-- colors\n";
+            const char* hex = "0123456789ABCDEF";
+            for (int y = 0; y < rows; ++y) {
+                std::string line;
+                for (int x = 0; x < cols; ++x) {
+                    WORD attr = grid[(size_t)y * cols + x].attr;
+                    line += hex[(attr >> 4) & 0x0F];
+                    line += hex[attr & 0x0F];
+                }
+                os << line << '\n';
+            }
+        }
+
+        // Summarizes the recorded frames. The first one is listed on its own: it includes loading the file.
+        void writeStats(std::ostream& os) const {
+            os << "Screen: " << rows << 'x' << cols << ", frames: " << frames.size() << '\n';
+            if (frames.empty()) return;
+            os << std::fixed;
+            os.precision(3);
+            os << "First frame: " << frames[0].milliseconds << " ms, " << frames[0].bytes << " bytes\n";
+            if (frames.size() < 2) return;
+
+            std::vector<double> times;
+            size_t totalBytes = 0, maxBytes = 0;
+            long long totalWritten = 0, totalChanged = 0;
+            int maxChanged = 0;
+            for (size_t i = 1; i < frames.size(); ++i) {
+                times.push_back(frames[i].milliseconds);
+                totalBytes += frames[i].bytes;
+                maxBytes = std::max(maxBytes, frames[i].bytes);
+                totalWritten += frames[i].cellsWritten;
+                totalChanged += frames[i].cellsChanged;
+                maxChanged = std::max(maxChanged, frames[i].cellsChanged);
+            }
+            double n = (double)times.size();
+            double totalTime = 0;
+            for (double t : times) totalTime += t;
+            std::sort(times.begin(), times.end());
+            auto percentile = [&times](double p) { return times[std::min(times.size() - 1, (size_t)(p * times.size()))]; };
+
+            os << "Time per frame (ms): avg " << totalTime / n << ", p50 " << percentile(0.50) << ", p99 " << percentile(0.99)
+               << ", max " << times.back() << '\n';
+            os.precision(1);
+            os << "Bytes per frame: avg " << totalBytes / n << ", max " << maxBytes << ", total " << totalBytes << '\n';
+            os << "Cells per frame: avg " << totalChanged / n << " changed (max " << maxChanged << "), avg "
+               << totalWritten / n << " written\n";
+        }
+
+        void getSize(int& screenRows, int& screenCols) override {
+            screenRows = rows;
+            screenCols = cols;
+        }
+
+        void writeCells(int row, int col, const Cell* cells, int count, const Cell* shownRow) override {
+            AnsiOutput::writeCells(row, col, cells, count, shownRow);
+            if (scriptDone) return;
+            Cell* shown = &grid[(size_t)row * cols + col];
+            for (int i = 0; i < count; ++i) {
+                if (shown[i] != cells[i]) ++current.cellsChanged;
+                shown[i] = cells[i];
+            }
+            current.cellsWritten += count;
+        }
+
+        void beginFrame(int frameRows, int frameWidth) override {
+            AnsiOutput::beginFrame(frameRows, frameWidth);
+            if (scriptDone) return;
+            shownCursorRow = shownCursorCol = -1;
+        }
+
+        void setCursor(int row, int col) override {
+            AnsiOutput::setCursor(row, col);
+            if (scriptDone) return;
+            shownCursorRow = row;
+            shownCursorCol = col;
+        }
+
+        bool scrollRows(int top, int bottom, int delta, int width) override {
+            AnsiOutput::scrollRows(top, bottom, delta, width);
+            if (scriptDone) return true;
+            auto rowStart = [this](int y) { return grid.begin() + (size_t)y * cols; };
+            if (delta > 0) {
+                std::copy(rowStart(top + delta), rowStart(bottom), rowStart(top));
+                std::fill(rowStart(bottom - delta), rowStart(bottom), Cell());
+            } else {
+                std::copy_backward(rowStart(top), rowStart(bottom + delta), rowStart(bottom));
+                std::fill(rowStart(top), rowStart(top - delta), Cell());
+            }
+            return true;
+        }
+
+        // A frame is timed from the first frameStarting() after the previous one, so time the editor
+        // spends idle between frames (background highlighting, the governor's waits) is not counted
+        void frameStarting() override {
+            if (frameTimed) return;
+            frameStart = std::chrono::steady_clock::now();
+            frameTimed = true;
+        }
+
+        // Frames end here: their bytes are counted and dropped, and the time since frameStarting() is recorded
+        void flush() override {
+            bool endsFrame = closeFrame();
+            current.bytes += out.size();
+            out.clear();
+            if (!endsFrame || scriptDone) return;
+            auto now = std::chrono::steady_clock::now();
+            current.milliseconds = std::chrono::duration<double, std::milli>(now - frameStart).count();
+            frames.push_back(current);
+            current = {};
+            frameStart = now;
+            frameTimed = false;
+        }
+
+        void clear() override {
+            out.clear();
+            forget();
+        }
+
+        int readKey() override {
+            if (keys.empty()) {
+                scriptDone = true;
+                quitWithEscape = !quitWithEscape;
+                lastCtrl = quitWithEscape;
+                lastShift = false;
+                return quitWithEscape ? 17 : 27;  // The script is done: Ctrl+Q, after an Esc out of whatever is open
+            }
+            ScriptedKey key = keys.front();
+            keys.pop_front();
+            lastCtrl = key.ctrl;
+            lastShift = key.shift;
+            if (key.code == KEY_RESIZE) {
+                rows = key.rows;
+                cols = key.cols;
+                grid.assign((size_t)rows * cols, Cell());  // A resized terminal's contents are not to be trusted
+                forget();
+            }
+            return key.code;
+        }
+
+        // Every key gets a frame of its own, as if typed one at a time
+        bool keyAvailable() override { return false; }
+        bool ctrlHeld() override { return lastCtrl; }
+        bool shiftHeld() override { return lastShift; }
+};
+
+std::unique_ptr<TerminalBackend> terminal;  // The terminal the editor draws on and reads keys from
+
+std::unique_ptr<TerminalBackend> createTerminalBackend() {
+#ifdef _WIN32
+    return std::make_unique<WinConsoleTerminal>();
+#else
+    return std::make_unique<AnsiTerminal>();
+#endif
+}
+
+// Double-buffered screen. A whole frame is composed into the back grid; present() compares it
+// with the front grid (what the terminal already shows) and hands only the runs of cells that
+// differ to the backend, so typing a character costs a couple of tiny writes instead of a full repaint.
+class ScreenGrid {
+    private:
+        int rows = 0;
+        int cols = 0;
+        std::vector<Cell> front;          // Last frame written to the terminal
+        std::vector<Cell> back;           // Frame being drawn
+        bool frontValid = false;          // False when the screen contents are unknown (first frame, resize, outside writes)
+        int cursorRow = -1;               // Where present() leaves the cursor (-1 = leave it alone)
+        int cursorCol = -1;
+        int scrollTop = 0;                // Rows [scrollTop, scrollBottom) may have moved by scrollDelta since the last frame
+        int scrollBottom = 0;
+        int scrollDelta = 0;
+
+        // Clean gaps shorter than this are written along with the runs around them; one call
+        // per run costs more than rewriting a few unchanged cells
+        static constexpr int MERGE_GAP = 8;
+
+        void writeRun(int row, int from, int to) {
+            terminal->writeCells(row, from, &back[row * cols + from], to - from, &front[row * cols]);
+            std::copy(back.begin() + row * cols + from, back.begin() + row * cols + to, front.begin() + row * cols + from);
+        }
+
+        bool rowsEqual(const Cell* a, const Cell* b) const {
+            return std::equal(a, a + cols, b);
+        }
+
+        // Shifts the terminal and the front grid when the hinted scroll leaves more rows already in
+        // place than not scrolling would. The newly exposed rows become unknown, so they get redrawn.
+        void applyScroll() {
+            int height = scrollBottom - scrollTop;
+            int delta = scrollDelta;
+            scrollDelta = 0;
+            if (!frontValid || delta == 0 || std::abs(delta) >= height) return;
+
+            int keptInPlace = 0, keptShifted = 0;
+            for (int y = scrollTop; y < scrollBottom; ++y) {
+                const Cell* want = &back[y * cols];
+                if (rowsEqual(want, &front[y * cols])) ++keptInPlace;
+                int source = y + delta;
+                if (source >= scrollTop && source < scrollBottom && rowsEqual(want, &front[source * cols])) ++keptShifted;
+            }
+            if (keptShifted <= keptInPlace) return;
+            if (!terminal->scrollRows(scrollTop, scrollBottom, delta, cols)) return;
+
+            const Cell unknown = { '\0', 0xFFFF };  // Never equal to a drawn cell
+            if (delta > 0) {
+                std::copy(front.begin() + (scrollTop + delta) * cols, front.begin() + scrollBottom * cols, front.begin() + scrollTop * cols);
+                std::fill(front.begin() + (scrollBottom - delta) * cols, front.begin() + scrollBottom * cols, unknown);
+            } else {
+                std::copy_backward(front.begin() + scrollTop * cols, front.begin() + (scrollBottom + delta) * cols, front.begin() + scrollBottom * cols);
+                std::fill(front.begin() + scrollTop * cols, front.begin() + (scrollTop - delta) * cols, unknown);
+            }
+        }
+
+    public:
+        // Starts a new frame of the given size with every cell blank
+        void beginFrame(int screenRows, int screenCols) {
+            if (screenRows != rows || screenCols != cols) {
+                rows = screenRows;
+                cols = screenCols;
+                front.assign((size_t)rows * cols, Cell());
+                frontValid = false;
+            }
+            back.assign((size_t)rows * cols, Cell());  // Same size as last frame: reuses the storage
+            cursorRow = cursorCol = -1;
+            scrollDelta = 0;
+        }
+
+        // Tells present() that the content of rows [top, bottom) moved up by `delta` rows (down if
+        // negative) since the last frame, so the terminal can shift it instead of repainting it
+        void hintScroll(int top, int bottom, int delta) {
+            scrollTop = std::max(0, top);
+            scrollBottom = std::min(rows, bottom);
+            scrollDelta = delta;
+        }
+
+        int cellCount() const { return (int)back.size(); }
+
+        // Attribute of a cell by row-major index (row * width + column)
+        WORD& attr(int index) { return back[index].attr; }
+
+        // Writes text starting at (row, col), clipped to the row; returns the column after it
+        int text(int row, int col, std::string_view s, WORD attribute) {
+            if (row < 0 || row >= rows) return col + (int)s.size();
+            int end = std::min(cols, col + (int)s.size());
+            for (int x = std::max(0, col); x < end; ++x) {
+                back[row * cols + x] = { s[x - col], attribute };
+            }
+            return col + (int)s.size();
+        }
+
+        // Recolors `count` cells starting at (row, col)
+        void fillAttr(int row, int col, int count, WORD attribute) {
+            if (row < 0 || row >= rows) return;
+            int end = std::min(cols, col + count);
+            for (int x = std::max(0, col); x < end; ++x) {
+                back[row * cols + x].attr = attribute;
+            }
+        }
+
+        // Kept inside the grid: terminals clamp an off-screen cursor, which would desync the tracked position
+        void setCursor(int row, int col) {
+            cursorRow = std::max(0, std::min(rows - 1, row));
+            cursorCol = std::max(0, std::min(cols - 1, col));
+        }
+
+        // Forget what the terminal shows, e.g. after something wrote to it behind the grid's back
+        void invalidate() {
+            frontValid = false;
+            if (terminal) terminal->forget();
+        }
+
+        // Writes the differences between the back and front grids; returns how many cells were written
+        int present() {
+            int cellsWritten = 0;
+            terminal->beginFrame(rows, cols);
+            applyScroll();
+            for (int y = 0; y < rows; ++y) {
+                const Cell* oldRow = &front[y * cols];
+                const Cell* newRow = &back[y * cols];
+
+                // Nothing to diff against: the whole row goes out
+                if (!frontValid) {
+                    writeRun(y, 0, cols);
+                    cellsWritten += cols;
+                    continue;
+                }
+
+                int x = 0;
+                while (x < cols) {
+                    // Find the next dirty cell, then extend the run until a long enough clean gap
+                    while (x < cols && oldRow[x] == newRow[x]) ++x;
+                    if (x == cols) break;
+                    int from = x;
+                    int to = x + 1;
+                    for (x = to; x < cols && x - to < MERGE_GAP; ++x) {
+                        if (oldRow[x] != newRow[x]) to = x + 1;
+                    }
+                    writeRun(y, from, to);
+                    cellsWritten += to - from;
+                    x = to;
+                }
+            }
+            frontValid = true;
+
+            if (cursorRow >= 0) {
+                terminal->setCursor(cursorRow, cursorCol);
+            }
+            terminal->flush();  // The whole frame leaves in one write
+            return cellsWritten;
+        }
+};
+
+// === Render Thread ===
+
+// One screen row as a view describes it: its text from column 0 and the colors laid over it,
+// applied in order (a later span wins where spans overlap)
+struct FrameRow {
+    std::string text;
+    std::vector<StyleSpan> spans;
+};
+
+// Everything needed to draw one frame, built by the views on the editor thread and handed over
+// whole to the render thread, which never looks at editor state. It takes the same drawing calls
+// as the grid. Snapshots are recycled, so once their buffers have grown building one does not allocate.
+class FrameSnapshot {
+    public:
+        int rows = 0;
+        int cols = 0;
+        std::vector<FrameRow> lines;      // At least `rows` entries; extra ones are left over from a taller frame
+        int cursorRow = -1;               // Where the cursor goes (-1 = leave it alone)
+        int cursorCol = -1;
+        int scrollTop = 0;                // See ScreenGrid::hintScroll
+        int scrollBottom = 0;
+        int scrollDelta = 0;
+        bool repaint = false;             // Something wrote to the terminal behind the grid's back
+        std::shared_ptr<const Palette> palette;  // Theme colors to draw with (null = the terminal's own)
+
+        // Starts a new frame of the given size with every row blank
+        void beginFrame(int screenRows, int screenCols) {
+            rows = screenRows;
+            cols = screenCols;
+            if ((int)lines.size() < rows) lines.resize(rows);
+            for (int y = 0; y < rows; ++y) {
+                lines[y].text.clear();
+                lines[y].text.reserve(cols);  // Whatever the row ends up holding, it fits without growing
+                lines[y].spans.clear();
+                lines[y].spans.reserve(cols + 8);  // One span per cell, plus the few a view draws over them
+            }
+            cursorRow = cursorCol = -1;
+            scrollDelta = 0;
+        }
+
+        void hintScroll(int top, int bottom, int delta) {
+            scrollTop = top;
+            scrollBottom = bottom;
+            scrollDelta = delta;
+        }
+
+        // Writes text starting at (row, col), clipped to the row; returns the column after it
+        int text(int row, int col, std::string_view s, WORD attribute) {
+            int from = std::max(0, col);
+            int end = std::min(cols, col + (int)s.size());
+            if (row >= 0 && row < rows && from < end) {
+                std::string& rowText = lines[row].text;
+                if ((int)rowText.size() < end) rowText.resize(end, ' ');
+                rowText.replace(from, end - from, s.data() + (from - col), end - from);
+                lines[row].spans.push_back({ from, end, attribute });
+            }
+            return col + (int)s.size();
+        }
+
+        // Recolors `count` cells starting at (row, col)
+        void fillAttr(int row, int col, int count, WORD attribute) {
+            int from = std::max(0, col);
+            int end = std::min(cols, col + count);
+            if (row >= 0 && row < rows && from < end) {
+                lines[row].spans.push_back({ from, end, attribute });
+            }
+        }
+
+        void setCursor(int row, int col) {
+            cursorRow = row;
+            cursorCol = col;
+        }
+
+        // Repaint every cell with this frame
+        void invalidate() {
+            repaint = true;
+        }
+};
+
+// Composes and writes frames on its own thread, so a slow terminal or a large repaint never holds
+// up key handling. Only the newest frame matters: one published while the previous one is still
+// waiting replaces it, and the skipped frame is never drawn. Three snapshots rotate between the
+// editor (building), the hand-off slot (pending) and this thread (drawing). The window size
+// travels in the snapshot too, and this thread hands it to the terminal in beginFrame().
+//
+// The split is at finished rows, not at line handles: lexing, span merging and laying out the
+// text still happen on the editor thread while it builds the snapshot (they read the document,
+// which only that thread may touch between keys). This thread owns the cell grid, the diff
+// against the screen and the escape-code encoding and write, which is where slow terminals stall.
+class RenderThread {
+    private:
+        ScreenGrid grid;                  // Only touched by the render thread
+        std::shared_ptr<const Palette> appliedPalette;  // Palette the terminal was last given
+        FrameSnapshot pending;            // Newest published frame, not drawn yet
+        FrameSnapshot drawing;            // Frame being drawn
+        bool hasPending = false;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread worker;
+
+        void compose(const FrameSnapshot& frame) {
+            grid.beginFrame(frame.rows, frame.cols);
+            if (frame.palette != appliedPalette) {
+                // A new theme: the backend compiles its color codes once here, and the screen is redrawn with them
+                appliedPalette = frame.palette;
+                terminal->setPalette(appliedPalette ? *appliedPalette : Palette());
+                grid.invalidate();
+            }
+            if (frame.repaint) grid.invalidate();
+            if (frame.scrollDelta != 0) grid.hintScroll(frame.scrollTop, frame.scrollBottom, frame.scrollDelta);
+            for (int y = 0; y < frame.rows; ++y) {
+                const FrameRow& row = frame.lines[y];
+                grid.text(y, 0, row.text, Cell().attr);
+                for (const StyleSpan& span : row.spans) {
+                    grid.fillAttr(y, span.from, span.to - span.from, span.attr);
+                }
+            }
+            if (frame.cursorRow >= 0) grid.setCursor(frame.cursorRow, frame.cursorCol);
+        }
+
+        void draw(const FrameSnapshot& frame) {
+#ifdef NITE_DEBUG_ALLOCS
+            size_t allocationsBefore = allocationCount;
+#endif
+            compose(frame);
+            grid.present();  // Write only the cells that changed since the last frame
+#ifdef NITE_DEBUG_ALLOCS
+            ++framesPresented;
+            if (allocationCount != allocationsBefore) ++framesAllocating;
+#endif
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return hasPending || stopping; });
+                if (!hasPending) break;  // Stopping, and the last frame is out
+                std::swap(pending, drawing);
+                hasPending = false;
+                lock.unlock();
+
+                draw(drawing);
+                lock.lock();
+            }
+        }
+
+    public:
+#ifdef NITE_DEBUG_ALLOCS
+        std::atomic<size_t> framesPresented{0};  // Frames written to the terminal
+        std::atomic<size_t> framesAllocating{0}; // Of those, frames whose composition touched the heap
+#endif
+
+        ~RenderThread() { stop(); }
+
+        void start() {
+            worker = std::thread(&RenderThread::run, this);
+        }
+
+        // Hands `frame` to the render thread and gives back a recycled snapshot to build the next one in.
+        // Without a started thread (headless runs) the frame is drawn right here, so every frame is drawn.
+        void publish(FrameSnapshot& frame) {
+            if (!worker.joinable()) {
+                draw(frame);
+                frame.repaint = false;
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (hasPending) {
+                    // The waiting frame is dropped; keep what it still owed the terminal
+                    frame.repaint = frame.repaint || pending.repaint;
+                    if (pending.scrollDelta != 0) {
+                        bool sameRegion = pending.scrollTop == frame.scrollTop && pending.scrollBottom == frame.scrollBottom;
+                        if (frame.scrollDelta != 0 && !sameRegion) {
+                            frame.scrollDelta = 0;  // No single shift describes both; the rows just get rewritten
+                        } else {
+                            frame.scrollTop = pending.scrollTop;
+                            frame.scrollBottom = pending.scrollBottom;
+                            frame.scrollDelta += pending.scrollDelta;
+                        }
+                    }
+                }
+                std::swap(pending, frame);
+                hasPending = true;
+            }
+            wake.notify_one();
+            frame.repaint = false;
+        }
+
+        // Draws the frame still waiting, if any, then ends the thread
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            if (worker.joinable()) worker.join();
+        }
+};
+
+FrameSnapshot screen;   // Every view draws its frame into this snapshot
+RenderThread renderer;  // Draws published snapshots
+
+namespace fs = std::filesystem;
+
+class FileNavigator {
+    private:
+        fs::path currentDirectory;
+        std::vector<fs::path> entries;
+        std::vector<std::string> entryLabels;  // What each entry shows ("..", "name/"), built with the list so drawing does not allocate
+        std::vector<char> entryIsDirectory;
+        std::string directoryLabel;            // currentDirectory as text
+        int selectedIndex = 0;
+        int scrollOffset = 0;
+        int screenRows;
+        int screenCols;
+        
+        // Colors for file browser (matching your existing color scheme)
+        const WORD DIRECTORY_COLOR = FOREGROUND_BLUE | FOREGROUND_INTENSITY;
+        const WORD FILE_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+        const WORD SELECTED_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+        
+        // Refresh the list of entries in the current directory
+        void refreshEntries() {
+            entries.clear();
+            
+            // Add parent directory entry (..) if not at root
+            if (currentDirectory.has_parent_path() && 
+                currentDirectory != currentDirectory.root_path()) {
+                entries.push_back(currentDirectory.parent_path());
+            }
+            
+            // Add all files and directories in the current directory
+            for (const auto& entry : fs::directory_iterator(currentDirectory)) {
+                entries.push_back(entry.path());
+            }
+            
+            // Sort entries: directories first, then files, both alphabetically
+            std::sort(entries.begin(), entries.end(), [](const fs::path& a, const fs::path& b) {
+                bool aIsDir = fs::is_directory(a);
+                bool bIsDir = fs::is_directory(b);
+                
+                if (aIsDir && !bIsDir) return true;
+                if (!aIsDir && bIsDir) return false;
+                
+                return a.filename().string() < b.filename().string();
+            });
+            
+            // Labels and directory flags for drawing
+            directoryLabel = currentDirectory.string();
+            entryLabels.clear();
+            entryIsDirectory.clear();
+            for (const fs::path& entry : entries) {
+                bool isDirectory = fs::is_directory(entry);
+                entryLabels.push_back((entry == currentDirectory.parent_path() ? std::string("..") : entry.filename().string()) +
+                                      (isDirectory ? "/" : ""));
+                entryIsDirectory.push_back(isDirectory);
+            }
+
+            // Reset selection if out of bounds
+            if (selectedIndex >= static_cast<int>(entries.size())) {
+                selectedIndex = std::max(0, static_cast<int>(entries.size()) - 1);
+            }
+            
+            // Adjust scroll offset if necessary
+            if (selectedIndex < scrollOffset) {
+                scrollOffset = selectedIndex;
+            } else if (selectedIndex >= scrollOffset + screenRows - 1) {
+                scrollOffset = selectedIndex - (screenRows - 1) + 1;
+            }
+        }
+        
+    public:
+        FileNavigator(const std::string& initialPath, int rows, int cols) 
+            : screenRows(rows), screenCols(cols) {
+            // Initialize with the given path or current directory if path is invalid
+            try {
+                currentDirectory = fs::absolute(initialPath);
+                if (!fs::exists(currentDirectory) || !fs::is_directory(currentDirectory)) {
+                    currentDirectory = fs::current_path();
+                }
+            } catch (...) {
+                currentDirectory = fs::current_path();
+            }
+            
+            refreshEntries();
+        }
+
+        // Takes a new window size, keeping the selection on screen
+        void resize(int rows, int cols) {
+            screenRows = rows;
+            screenCols = cols;
+            if (selectedIndex >= scrollOffset + screenRows - 2) {
+                scrollOffset = selectedIndex - (screenRows - 2) + 1;
+            }
+        }
+        
+        // Draw the file browser interface
+        void drawFileBrowser() {
+            screen.beginFrame(screenRows, screenCols);
+            const WORD BAR_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;  // White on blue background
+
+            // Title bar
+            screen.fillAttr(0, 0, screenCols, BAR_COLOR);
+            std::string_view directory = directoryLabel;
+            int col = screen.text(0, 0, " File Browser: ", BAR_COLOR);
+            if (col + (int)directory.size() + 1 > screenCols) {
+                // Truncate with ellipsis if too long
+                col = screen.text(0, col, "...", BAR_COLOR);
+                directory = directory.substr(directory.size() - std::min(directory.size(), (size_t)std::max(0, screenCols - 20)));
+            }
+            screen.text(0, col, directory, BAR_COLOR);
+            
+            // Add each visible entry
+            for (int i = 0; i < screenRows - 2; i++) {
+                int entryIndex = i + scrollOffset;
+                
+                if (entryIndex < static_cast<int>(entries.size())) {
+                    std::string_view filename = entryLabels[entryIndex];
+                    WORD baseColor = entryIsDirectory[entryIndex] ? DIRECTORY_COLOR : FILE_COLOR;
+                    WORD color = (entryIndex == selectedIndex) ? SELECTED_COLOR : baseColor;
+
+                    // Selection cursor, then the name, truncated if too long for display
+                    screen.fillAttr(i + 1, 0, screenCols, color);
+                    col = screen.text(i + 1, 0, entryIndex == selectedIndex ? "> " : "  ", color);
+                    if (filename.size() > static_cast<size_t>(screenCols - 4)) {
+                        col = screen.text(i + 1, col, filename.substr(0, std::max(0, screenCols - 7)), color);
+                        screen.text(i + 1, col, "...", color);
+                    } else {
+                        screen.text(i + 1, col, filename, color);
+                    }
+                }
+                // Rows past the last entry stay blank
+            }
+            
+            // Status bar / help line
+            screen.fillAttr(screenRows - 1, 0, screenCols, BAR_COLOR);
+            screen.text(screenRows - 1, 0, " [↑/↓] Navigate  [Enter] Open/Enter  [Esc] Cancel ", BAR_COLOR);
+        }
+        
+        // Handle keyboard input and navigation
+        bool handleInput(int key) {
+            switch (key) {
+                case VK_UP:    // Up arrow
+                    if (selectedIndex > 0) {
+                        selectedIndex--;
+                        // Adjust scroll if necessary
+                        if (selectedIndex < scrollOffset) {
+                            scrollOffset = selectedIndex;
+                        }
+                    }
+                    return true;
+                    
+                case VK_DOWN:  // Down arrow
+                    if (selectedIndex < static_cast<int>(entries.size()) - 1) {
+                        selectedIndex++;
+                        // Adjust scroll if necessary
+                        if (selectedIndex >= scrollOffset + screenRows - 2) {
+                            scrollOffset = selectedIndex - (screenRows - 2) + 1;
+                        }
+                    }
+                    return true;
+                    
+                case VK_RETURN:  // Enter key
+                    if (selectedIndex >= 0 && selectedIndex < static_cast<int>(entries.size())) {
+                        const fs::path& selected = entries[selectedIndex];
+                        
+                        if (fs::is_directory(selected)) {
+                            // Enter directory
+                            currentDirectory = selected;
+                            selectedIndex = 0;
+                            scrollOffset = 0;
+                            refreshEntries();
+                            return true;
+                        } else {
+                            // Return the selected file path to be opened
+                            return false;  // Exit file browser mode
+                        }
+                    }
+                    return true;
+                    
+                case VK_ESCAPE:  // Escape key
+                    return false;  // Cancel and exit file browser mode
+                    
+                default:
+                    return true;  // Ignore other keys
+            }
+        }
+        
+        // Get the currently selected file path (if a file is selected)
+        fs::path getSelectedFile() const {
+            if (selectedIndex >= 0 && selectedIndex < static_cast<int>(entries.size())) {
+                const fs::path& selected = entries[selectedIndex];
+                if (!fs::is_directory(selected)) {
+                    return selected;
+                }
+            }
+            return fs::path();  // Empty path if no file selected
+        }
+
+        fs::path getCurrentDirectory() const {
+            return currentDirectory;
+        }
+};
+
+// === Project Search ===
+
+// Read-only memory mapping of a whole file. Searching the mapped pages directly avoids
+// copying every file through an ifstream buffer first.
+class MappedFile {
+    private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#endif
+        const char* view = nullptr;
+        size_t length = 0;
+
+    public:
+#ifdef _WIN32
+        explicit MappedFile(const std::string& path) {
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) return;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;  // Empty files cannot be mapped
+
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping == NULL) return;
+            view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (view) length = (size_t)size.QuadPart;
+        }
+
+        ~MappedFile() {
+            if (view) UnmapViewOfFile(view);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        }
+#else
+        explicit MappedFile(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {  // Empty files cannot be mapped
+                void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    view = static_cast<const char*>(mapped);
+                    length = (size_t)info.st_size;
+                }
+            }
+            close(fd);  // The mapping stays valid after the descriptor is closed
+        }
+
+        ~MappedFile() {
+            if (view) munmap(const_cast<char*>(view), length);
+        }
+#endif
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return view; }
+        size_t size() const { return length; }
+};
+
+// Same heuristic as git and grep: a NUL byte in the first 8 KB means the file is binary
+bool looksBinary(const char* data, size_t size) {
+    return std::memchr(data, '\0', std::min(size, (size_t)8192)) != nullptr;
+}
+
+// Thread pool where every worker owns a task deque. Workers pop their own newest task first
+// (keeping a directory walk depth-first and cache-warm) and steal the oldest task of another
+// worker when they run dry, so one huge directory never leaves the other cores idle.
+class WorkStealingPool {
+    private:
+        struct Queue {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<int> pending{0};        // Submitted tasks that have not finished yet
+        std::atomic<bool> stopping{false};
+        std::atomic<unsigned> nextQueue{0}; // Round-robin target for submissions from outside the pool
+        std::mutex idleLock;                // Guards queued and stopping for the waits below
+        int queued = 0;                     // Tasks sitting in a queue that no worker has claimed yet
+        std::condition_variable workReady;  // Signals parked workers: a task was queued, or the pool is stopping
+        std::condition_variable allDone;    // Signals wait(): pending dropped to zero
+
+        static thread_local WorkStealingPool* currentPool;
+        static thread_local int currentWorker;
+
+        bool takeTask(int self, std::function<void()>& task) {
+            // Own queue first, newest task (LIFO)
+            {
+                Queue& own = *queues[self];
+                std::lock_guard<std::mutex> guard(own.lock);
+                if (!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            // Then steal the oldest task (FIFO) from the others
+            for (size_t i = 1; i < queues.size(); ++i) {
+                Queue& victim = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // A worker sleeps until a task is queued, claims it by taking one off `queued`, and then
+        // takes whichever task it finds first. Every claim is backed by a queued task, so the
+        // search only comes up empty for a moment while another worker races it for the same queue.
+        void workerLoop(int self) {
+            currentPool = this;
+            currentWorker = self;
+            std::function<void()> task;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> guard(idleLock);
+                    workReady.wait(guard, [this] { return queued > 0 || stopping; });
+                    if (queued == 0) return;  // Stopping, and nothing left to run
+                    --queued;
+                }
+                while (!takeTask(self, task)) std::this_thread::yield();
+                task();
+                task = nullptr;
+                if (--pending == 0) {
+                    std::lock_guard<std::mutex> guard(idleLock);
+                    allDone.notify_all();
+                }
+            }
+        }
+
+    public:
+        explicit WorkStealingPool(int threadCount = 0) {
+            if (threadCount <= 0) threadCount = std::max(2u, std::thread::hardware_concurrency());
+            for (int i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<Queue>());
+            for (int i = 0; i < threadCount; ++i) workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+
+        ~WorkStealingPool() {
+            wait();
+            {
+                std::lock_guard<std::mutex> guard(idleLock);
+                stopping = true;
+            }
+            workReady.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // Queues a task; tasks submitted from a worker land on that worker's own deque
+        void submit(std::function<void()> task) {
+            ++pending;
+            int target = currentPool == this ? currentWorker : (int)(nextQueue++ % queues.size());
+            {
+                std::lock_guard<std::mutex> guard(queues[target]->lock);
+                queues[target]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> guard(idleLock);
+                ++queued;
+            }
+            workReady.notify_one();
+        }
+
+        bool isIdle() const { return pending == 0; }
+
+        // Blocks until every submitted task (including the ones they submitted) has finished
+        void wait() {
+            std::unique_lock<std::mutex> guard(idleLock);
+            allDone.wait(guard, [this] { return pending == 0; });
+        }
+};
+
+thread_local WorkStealingPool* WorkStealingPool::currentPool = nullptr;
+thread_local int WorkStealingPool::currentWorker = 0;
+
+// Walks `dir` recursively on the pool: every subdirectory becomes its own task and `onFile` runs
+// on the worker that found the file. Hidden entries (.git, .vs, ...) and symlinks are skipped.
+void walkTreeParallel(WorkStealingPool& pool, const fs::path& dir, const std::atomic<bool>& cancelled,
+                      const std::function<void(const fs::path&)>& onFile) {
+    pool.submit([&pool, dir, &cancelled, &onFile] {
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end && !cancelled; it.increment(ec)) {
+            const fs::path& path = it->path();
+            std::string name = path.filename().string();
+            if (name.empty() || name[0] == '.') continue;
+
+            std::error_code statusError;
+            fs::file_status status = it->symlink_status(statusError);
+            if (statusError || fs::is_symlink(status)) continue;
+
+            if (fs::is_directory(status)) {
+                walkTreeParallel(pool, path, cancelled, onFile);
+            } else if (fs::is_regular_file(status)) {
+                onFile(path);
+            }
+        }
+    });
+}
+
+// One line of a directory search result (or one file of a replace preview, when line < 0)
+struct SearchHit {
+    std::string path;     // Full path of the file
+    std::string display;  // Path relative to the search root, for the results list
+    int line = 0;         // Zero-based line number, or -1 for a whole-file entry
+    int column = 0;       // Zero-based column as the editor shows it (tabs expanded)
+    std::string preview;  // The matching line trimmed for display, or a per-file summary
+};
+
+// Results that worker threads append to while the UI thread reads pages of them
+class HitList {
+    private:
+        mutable std::mutex lock;
+        std::vector<SearchHit> hits;
+        size_t limit;
+        bool truncated = false;
+
+    public:
+        explicit HitList(size_t maxHits) : limit(maxHits) {}
+
+        void append(std::vector<SearchHit>& found) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (hits.size() + found.size() > limit) {
+                found.resize(limit - std::min(limit, hits.size()));
+                truncated = true;
+            }
+            hits.insert(hits.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> guard(lock);
+            return hits.size();
+        }
+
+        bool isTruncated() const {
+            std::lock_guard<std::mutex> guard(lock);
+            return truncated;
+        }
+
+        // Copies hits [from, from + count) so the caller can draw without holding the lock
+        std::vector<SearchHit> get(size_t from, size_t count) const {
+            std::lock_guard<std::mutex> guard(lock);
+            if (from >= hits.size()) return {};
+            auto first = hits.begin() + from;
+            return std::vector<SearchHit>(first, first + std::min(count, hits.size() - from));
+        }
+
+        // Snapshot of every entry, for passes that must see all of them
+        std::vector<SearchHit> all() const {
+            std::lock_guard<std::mutex> guard(lock);
+            return hits;
+        }
+};
+
+// Column of `pos` as the editor will show it, since opened files get their tabs expanded
+int displayColumn(const char* lineStart, const char* pos) {
+    int column = 0;
+    for (const char* p = lineStart; p < pos; ++p) column += *p == '\t' ? tabSize : 1;
+    return column;
+}
+
+// Path of `path` below `root`, for result lists
+std::string displayPath(const fs::path& root, const std::string& path) {
+    return path.substr(std::min(path.size(), root.string().size() + 1));
+}
+
+// Greps a whole directory tree for a literal in the background. Files are memory mapped,
+// binaries are skipped and every file's hits are appended to `hits` as soon as it is done,
+// so the results list can be browsed while the search is still running.
+class ProjectSearch {
+    private:
+        fs::path root;
+        LiteralSearcher searcher;
+        HitList hits{100000};
+        std::atomic<size_t> filesMatched{0};
+        std::atomic<size_t> filesSearched{0};
+        std::atomic<size_t> filesSkipped{0};  // Binary files
+        std::function<void(const fs::path&)> onFile;  // Must outlive the pool's tasks, so declared first
+        std::atomic<bool> cancelled{false};
+        std::unique_ptr<WorkStealingPool> pool;
+
+        static std::string makePreview(const char* lineStart, const char* lineEnd) {
+            while (lineStart < lineEnd && (*lineStart == ' ' || *lineStart == '\t')) ++lineStart;
+            if (lineEnd > lineStart && lineEnd[-1] == '\r') --lineEnd;
+            std::string preview(lineStart, std::min(lineEnd, lineStart + 200));
+            std::replace(preview.begin(), preview.end(), '\t', ' ');
+            return preview;
+        }
+
+        void searchFile(const fs::path& path) {
+            MappedFile file(path.string());
+            if (file.size() == 0) return;  // Empty or unreadable
+            const char* begin = file.data();
+            const char* end = begin + file.size();
+            if (looksBinary(begin, file.size())) {
+                ++filesSkipped;
+                return;
+            }
+            ++filesSearched;
+
+            std::vector<SearchHit> found;
+            std::string pathString = path.string();
+            std::string display = displayPath(root, pathString);
+            int lineNumber = 0;
+            const char* lineStart = begin;
+            for (const char* hit = searcher.find(begin, end); hit != end && !cancelled; ) {
+                // Count the newlines between the previous hit and this one
+                for (const char* nl; (nl = static_cast<const char*>(std::memchr(lineStart, '\n', hit - lineStart))); ) {
+                    ++lineNumber;
+                    lineStart = nl + 1;
+                }
+                const char* lineEnd = static_cast<const char*>(std::memchr(hit, '\n', end - hit));
+                if (!lineEnd) lineEnd = end;
+
+                SearchHit entry;
+                entry.path = pathString;
+                entry.display = display;
+                entry.line = lineNumber;
+                entry.column = displayColumn(lineStart, hit);
+                entry.preview = makePreview(lineStart, lineEnd);
+                found.push_back(std::move(entry));
+
+                // One entry per line, like grep: continue after the end of this line
+                hit = lineEnd == end ? end : searcher.find(lineEnd + 1, end);
+            }
+
+            if (found.empty()) return;
+            ++filesMatched;
+            hits.append(found);
+        }
+
+    public:
+        ProjectSearch(const fs::path& directory, const std::string& query)
+            : root(directory), searcher(query) {
+            onFile = [this](const fs::path& path) { searchFile(path); };
+            pool = std::make_unique<WorkStealingPool>();
+            walkTreeParallel(*pool, root, cancelled, onFile);
+        }
+
+        ~ProjectSearch() {
+            cancelled = true;
+            pool.reset();  // Joins the workers before the members they use go away
+        }
+
+        const fs::path& getRoot() const { return root; }
+        const std::string& getQuery() const { return searcher.pattern(); }
+        bool isFinished() const { return pool->isIdle(); }
+        const HitList& getHits() const { return hits; }
+
+        std::string summary() const {
+            return std::to_string(hits.size()) + (hits.isTruncated() ? "+" : "") + " hits in " +
+                   std::to_string(filesMatched.load()) + " files (" + std::to_string(filesSearched.load()) +
+                   " searched, " + std::to_string(filesSkipped.load()) + " binary skipped)";
+        }
+};
+
+// Streams `data` to `out` with every non-overlapping occurrence of the searcher's pattern
+// replaced, writing the untouched stretches in between as whole blocks. Returns the count.
+size_t replaceLiteralStream(const char* begin, const char* end, const LiteralSearcher& searcher,
+                            const std::string& replacement, std::ostream& out) {
+    size_t count = 0;
+    const char* copied = begin;
+    for (const char* hit = searcher.find(begin, end); hit != end; hit = searcher.find(hit + searcher.size(), end)) {
+        out.write(copied, hit - copied);
+        out.write(replacement.data(), replacement.size());
+        copied = hit + searcher.size();
+        ++count;
+    }
+    out.write(copied, end - copied);
+    return count;
+}
+
+// Replaces a literal in every text file below a directory, all or nothing. The constructor
+// runs a parallel dry run that lists the count per file; apply() then streams each file into
+// a temp file next to it, and only once every temp file is written are the originals swapped
+// out (with backups, so a failed rename is rolled back). Temp and backup files get fresh random
+// names that are created exclusively, so no existing file is ever overwritten. If a rollback
+// itself fails, the status names the files left replaced and where their originals are.
+class ProjectReplace {
+    public:
+        enum State { Scanning, Previewed, Applying, Applied, Failed };
+
+    private:
+        fs::path root;
+        LiteralSearcher searcher;
+        std::string replacement;
+        HitList files{1000000};  // One entry per file that contains the pattern
+        std::atomic<size_t> totalCount{0};
+        std::atomic<int> state{Scanning};
+        mutable std::mutex messageLock;
+        std::string message;     // Outcome of apply(), shown in the status bar
+        std::function<void(const fs::path&)> onFile;
+        std::atomic<bool> cancelled{false};
+        std::unique_ptr<WorkStealingPool> pool;
+        std::thread applier;
+
+        std::unordered_set<std::string> touchedPaths;  // Canonical path of every replaced file, filled before state turns Applied
+
+        static constexpr const char* tempTag = ".nite-tmp-";
+        static constexpr const char* backupTag = ".nite-bak-";
+
+        // Creates an empty file named <path><tag><random hex> that did not exist before and
+        // returns its name, or "" if no free name could be claimed
+        static std::string claimScratchName(const std::string& path, const char* tag) {
+            static const char* digits = "0123456789abcdef";
+            thread_local std::mt19937_64 random(std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id()));
+            for (int attempt = 0; attempt < 16; ++attempt) {
+                uint64_t bits = random();
+                std::string name = path + tag;
+                for (int i = 0; i < 12; ++i, bits >>= 4) name += digits[bits & 15];
+                FILE* claimed = std::fopen(name.c_str(), "wbx");  // Fails if the name is taken
+                if (claimed) {
+                    std::fclose(claimed);
+                    return name;
+                }
+                if (errno != EEXIST) return "";
+            }
+            return "";
+        }
+
+        void countFile(const fs::path& path) {
+            std::string pathString = path.string();
+            std::string name = path.filename().string();
+            if (name.find(tempTag) != std::string::npos || name.find(backupTag) != std::string::npos) return;
+
+            MappedFile file(pathString);
+            if (file.size() == 0 || looksBinary(file.data(), file.size())) return;
+            const char* end = file.data() + file.size();
+            size_t count = 0;
+            for (const char* hit = searcher.find(file.data(), end); hit != end && !cancelled;
+                 hit = searcher.find(hit + searcher.size(), end)) {
+                ++count;
+            }
+            if (count == 0) return;
+
+            totalCount += count;
+            std::vector<SearchHit> entry(1);
+            entry[0].path = pathString;
+            entry[0].display = displayPath(root, pathString);
+            entry[0].line = -1;
+            entry[0].preview = std::to_string(count) + (count == 1 ? " replacement" : " replacements");
+            files.append(entry);
+        }
+
+        // Phase 1 for one file: the replaced text goes to a fresh temp file, stored in `tempPath`; the original is untouched
+        static std::string writeTemp(const std::string& path, const LiteralSearcher& searcher, const std::string& replacement,
+                                     std::string& tempPath) {
+            MappedFile file(path);
+            if (file.size() == 0) return "could not read the file";
+
+            tempPath = claimScratchName(path, tempTag);
+            if (tempPath.empty()) return "could not create a temp file next to it";
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);  // Ours: claimScratchName just created it
+            if (!out.is_open()) return "could not open " + tempPath;
+            replaceLiteralStream(file.data(), file.data() + file.size(), searcher, replacement, out);
+            out.close();
+            if (!out) return "could not write " + tempPath;
+
+            std::error_code ec;
+            fs::permissions(tempPath, fs::status(path, ec).permissions(), ec);
+            return "";
+        }
+
+        void setOutcome(State outcome, const std::string& text) {
+            {
+                std::lock_guard<std::mutex> guard(messageLock);
+                message = text;
+            }
+            state = outcome;
+        }
+
+        void applyAll() {
+            std::vector<SearchHit> targets = files.all();
+
+            std::vector<std::string> temps(targets.size());    // Temp file of every target, "" until claimed
+            std::vector<std::string> backups(targets.size());  // Backup of every swapped target
+
+            // Phase 1: write every temp file in parallel
+            std::mutex failureLock;
+            std::string failure;
+            {
+                WorkStealingPool writers;
+                for (size_t i = 0; i < targets.size(); ++i) {
+                    writers.submit([this, &targets, &temps, i, &failureLock, &failure] {
+                        std::string error = writeTemp(targets[i].path, searcher, replacement, temps[i]);
+                        if (error.empty()) return;
+                        std::lock_guard<std::mutex> guard(failureLock);
+                        if (failure.empty()) failure = targets[i].path + ": " + error;
+                    });
+                }
+            }
+
+            std::error_code ec;
+            if (!failure.empty()) {
+                for (const auto& temp : temps) if (!temp.empty()) fs::remove(temp, ec);
+                setOutcome(Failed, "Nothing changed, " + failure);
+                return;
+            }
+
+            // Phase 2: swap every file in, keeping the original as a backup until all succeeded.
+            // The backup name is claimed first, so the rename only ever replaces our own empty file.
+            std::vector<std::string> unrestored;  // "<file> (original in <backup>)" for every failed rollback
+            size_t swapped = 0;
+            for (; swapped < targets.size(); ++swapped) {
+                const std::string& path = targets[swapped].path;
+                backups[swapped] = claimScratchName(path, backupTag);
+                if (backups[swapped].empty()) {
+                    ec = std::make_error_code(std::errc::file_exists);
+                    break;
+                }
+                fs::rename(path, backups[swapped], ec);
+                if (ec) {
+                    std::error_code cleanupError;
+                    fs::remove(backups[swapped], cleanupError);
+                    break;
+                }
+                fs::rename(temps[swapped], path, ec);
+                if (ec) {
+                    std::error_code restoreError;
+                    fs::rename(backups[swapped], path, restoreError);
+                    if (restoreError) unrestored.push_back(path + " (original in " + backups[swapped] + ")");
+                    break;
+                }
+            }
+
+            if (swapped < targets.size()) {
+                // Roll back the files that were already swapped and drop the rest of the temps
+                std::string reason = targets[swapped].path + ": " + ec.message();
+                for (size_t i = 0; i < swapped; ++i) {
+                    std::error_code restoreError;
+                    fs::rename(backups[i], targets[i].path, restoreError);  // Replaces the new contents
+                    if (restoreError) unrestored.push_back(targets[i].path + " (original in " + backups[i] + ")");
+                }
+                for (size_t i = swapped; i < targets.size(); ++i) fs::remove(temps[i], ec);
+
+                if (unrestored.empty()) {
+                    setOutcome(Failed, "Nothing changed, rename failed for " + reason);
+                } else {
+                    std::string list;
+                    for (const auto& entry : unrestored) list += (list.empty() ? "" : ", ") + entry;
+                    setOutcome(Failed, "Rename failed for " + reason + "; could not restore " + list);
+                }
+                return;
+            }
+
+            // Phase 3: everything is in place, the backups can go
+            for (size_t i = 0; i < targets.size(); ++i) {
+                fs::remove(backups[i], ec);
+                std::string canonical = fs::weakly_canonical(targets[i].path, ec).string();
+                touchedPaths.insert(ec ? targets[i].path : canonical);
+            }
+            setOutcome(Applied, "Replaced " + std::to_string(totalCount.load()) + " occurrences in " +
+                                std::to_string(targets.size()) + " files");
+        }
+
+    public:
+        ProjectReplace(const fs::path& directory, const std::string& find, const std::string& replaceWith)
+            : root(directory), searcher(find), replacement(replaceWith) {
+            onFile = [this](const fs::path& path) { countFile(path); };
+            pool = std::make_unique<WorkStealingPool>();
+            walkTreeParallel(*pool, root, cancelled, onFile);
+        }
+
+        ~ProjectReplace() {
+            cancelled = true;
+            pool.reset();
+            if (applier.joinable()) applier.join();  // Never abandon a commit halfway
+        }
+
+        const fs::path& getRoot() const { return root; }
+        const std::string& getQuery() const { return searcher.pattern(); }
+        const std::string& getReplacement() const { return replacement; }
+        const HitList& getFiles() const { return files; }
+
+        State getState() {
+            if (state == Scanning && pool->isIdle()) state = Previewed;
+            return (State)state.load();
+        }
+
+        bool isBusy() {
+            State current = getState();
+            return current == Scanning || current == Applying;
+        }
+
+        // Starts writing the replacements; only valid once the dry run has finished
+        bool apply() {
+            if (getState() != Previewed || files.size() == 0) return false;
+            state = Applying;
+            applier = std::thread([this] { applyAll(); });
+            return true;
+        }
+
+        // Whether the applied replace rewrote `path`: one canonicalization and a set lookup
+        bool touched(const std::string& path) const {
+            if (state != Applied) return false;
+            std::error_code ec;
+            std::string canonical = fs::weakly_canonical(path, ec).string();
+            return touchedPaths.count(ec ? path : canonical) != 0;
+        }
+
+        std::string summary() {
+            switch (getState()) {
+                case Scanning:
+                    return "Dry run: " + std::to_string(totalCount.load()) + " occurrences in " +
+                           std::to_string(files.size()) + " files so far...";
+                case Previewed:
+                    return "Dry run: " + std::to_string(totalCount.load()) + " occurrences in " +
+                           std::to_string(files.size()) + " files  [Enter] Apply  [Esc] Cancel";
+                case Applying:
+                    return "Applying...";
+                default: {
+                    std::lock_guard<std::mutex> guard(messageLock);
+                    return message + "  [Esc] Close";
+                }
+            }
+        }
+};
+
+// Scrollable list of directory search results, drawn the same way as the file browser
+class SearchResultsView {
+    private:
+        int selectedIndex = 0;
+        int scrollOffset = 0;
+        int screenRows;
+        int screenCols;
+
+        const WORD BAR_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+        const WORD PATH_COLOR = FOREGROUND_BLUE | FOREGROUND_INTENSITY;
+        const WORD TEXT_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+        const WORD SELECTED_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+
+        int listRows() const { return std::max(1, screenRows - 2); }
+
+        std::string fitLine(const std::string& text) const {
+            if ((int)text.size() >= screenCols) return text.substr(0, screenCols);
+            return text + std::string(screenCols - text.size(), ' ');
+        }
+
+    public:
+        SearchResultsView(int rows, int cols) : screenRows(rows), screenCols(cols) {}
+
+        // Takes a new window size, keeping the selection on screen
+        void resize(int rows, int cols) {
+            screenRows = rows;
+            screenCols = cols;
+            if (selectedIndex >= scrollOffset + listRows()) scrollOffset = selectedIndex - listRows() + 1;
+        }
+
+        int getSelectedIndex() const { return selectedIndex; }
+
+        void draw(const std::string& title, const HitList& results, const std::string& status) {
+            std::vector<SearchHit> visible = results.get(scrollOffset, listRows());
+            screen.beginFrame(screenRows, screenCols);
+
+            // Title bar
+            screen.text(0, 0, fitLine(" " + title), BAR_COLOR);
+
+            // One row per hit: "path:line: preview", or "path: summary" for whole-file entries
+            for (int i = 0; i < listRows() && i < (int)visible.size(); ++i) {
+                const SearchHit& hit = visible[i];
+                std::string location = hit.display + (hit.line >= 0 ? ":" + std::to_string(hit.line + 1) : "") + ": ";
+                bool selected = scrollOffset + i == selectedIndex;
+                screen.text(i + 1, 0, fitLine((selected ? "> " : "  ") + location + hit.preview), selected ? SELECTED_COLOR : TEXT_COLOR);
+                if (!selected) {
+                    screen.fillAttr(i + 1, 0, 2 + (int)location.size(), PATH_COLOR);
+                }
+            }
+
+            // Status bar / help line
+            screen.text(screenRows - 1, 0, fitLine(" " + status), BAR_COLOR);
+        }
+
+        // Moves the selection by `delta` rows within `count` results
+        void moveSelection(int delta, int count) {
+            if (count <= 0) return;
+            selectedIndex = std::max(0, std::min(count - 1, selectedIndex + delta));
+            if (selectedIndex < scrollOffset) {
+                scrollOffset = selectedIndex;
+            } else if (selectedIndex >= scrollOffset + listRows()) {
+                scrollOffset = selectedIndex - listRows() + 1;
+            }
+        }
+};
+
+// === Fuzzy Finder ===
+
+// One bit per character class (case-insensitive). A path can only contain the query as a
+// subsequence if its mask covers the query's mask, which rejects most paths with one AND.
+uint64_t charClassMask(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    if (c >= 'a' && c <= 'z') return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ULL << (26 + c - '0');
+    switch (c) {
+        case '_': return 1ULL << 36;
+        case '-': return 1ULL << 37;
+        case '.': return 1ULL << 38;
+        case '/': return 1ULL << 39;
+        default:  return 1ULL << (40 + c % 24);
+    }
+}
+
+// Where the path index of `root` is saved between sessions: a per-user cache directory
+// (%LOCALAPPDATA%\nite, $XDG_CACHE_HOME/nite or ~/.cache/nite), never the executable's directory.
+// Returns "" when there is no such directory, and the index is then simply not kept.
+std::string pathIndexCacheFile(const fs::path& root) {
+#ifdef _WIN32
+    const char* base = getenv("LOCALAPPDATA");
+    fs::path dir = base && *base ? fs::path(base) / "nite" : fs::path();
+#else
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    fs::path dir = xdg && *xdg ? fs::path(xdg) / "nite" : home && *home ? fs::path(home) / ".cache" / "nite" : fs::path();
+#endif
+    std::error_code ec;
+    if (dir.empty() || (!fs::create_directories(dir, ec) && ec)) return "";
+    return (dir / ("niteindex-" + std::to_string(std::hash<std::string>{}(root.generic_string())))).string();
+}
+
+// Every file below a project root, packed into one string pool plus offsets so half a million
+// paths stay a few flat allocations. Saved to disk so the next launch starts warm.
+class PathIndex {
+    private:
+        std::string pool;               // All paths back to back, relative to the root with '/' separators
+        std::vector<uint32_t> offsets;  // Start of every path in `pool`, plus an end sentinel
+        std::vector<uint64_t> masks;    // charClassMask of every path
+
+        void computeMasks() {
+            masks.assign(size(), 0);
+            for (size_t i = 0; i < size(); ++i) {
+                uint64_t mask = 0;
+                for (unsigned char c : path(i)) mask |= charClassMask(c);
+                masks[i] = mask;
+            }
+        }
+
+    public:
+        size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+        std::string_view path(size_t i) const { return std::string_view(pool).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+        uint64_t mask(size_t i) const { return masks[i]; }
+
+        // Walks `root` on a work-stealing pool and packs the sorted results
+        static PathIndex build(const fs::path& root, const std::atomic<bool>& cancelled) {
+            std::mutex collectLock;
+            std::vector<std::string> found;
+            size_t rootLength = root.generic_string().size() + 1;
+            std::function<void(const fs::path&)> onFile = [&](const fs::path& path) {
+                std::string relative = path.generic_string().substr(rootLength);
+                std::lock_guard<std::mutex> guard(collectLock);
+                found.push_back(std::move(relative));
+            };
+            {
+                WorkStealingPool pool;
+                walkTreeParallel(pool, root, cancelled, onFile);
+            }
+            std::sort(found.begin(), found.end());
+
+            PathIndex index;
+            index.offsets.reserve(found.size() + 1);
+            for (const auto& path : found) {
+                index.offsets.push_back((uint32_t)index.pool.size());
+                index.pool += path;
+            }
+            index.offsets.push_back((uint32_t)index.pool.size());
+            index.computeMasks();
+            return index;
+        }
+
+        // Writes the index to a temp file beside `file` and renames it over `file`, so another
+        // instance loading the same cache sees either the old index or the new one, never half of one
+        bool save(const std::string& file, const std::string& root) const {
+            std::string tempFile = file + ".tmp-" + std::to_string(std::random_device{}());
+            {
+                std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+                if (!out.is_open()) return false;
+                uint32_t header[3] = { (uint32_t)root.size(), (uint32_t)size(), (uint32_t)pool.size() };
+                out.write("NITEIDX1", 8);
+                out.write(reinterpret_cast<const char*>(header), sizeof(header));
+                out.write(root.data(), root.size());
+                out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+                out.write(pool.data(), pool.size());
+                out.close();
+                if (!out) {
+                    std::error_code ec;
+                    fs::remove(tempFile, ec);
+                    return false;
+                }
+            }
+            std::error_code ec;
+            fs::rename(tempFile, file, ec);
+            if (ec) fs::remove(tempFile, ec);
+            return !ec;
+        }
+
+        // Loads a saved index, but only if it was built for the same root. The header's counts are
+        // checked against the bytes actually in the file before anything is allocated for them.
+        bool load(const std::string& file, const std::string& root) {
+            std::error_code ec;
+            uint64_t fileSize = fs::file_size(file, ec);
+            if (ec) return false;
+            std::ifstream in(file, std::ios::binary);
+            char magic[8];
+            uint32_t header[3];
+            if (!in.read(magic, 8) || std::string(magic, 8) != "NITEIDX1") return false;
+            if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != root.size()) return false;
+            uint64_t needed = 8 + sizeof(header) + (uint64_t)header[0] + ((uint64_t)header[1] + 1) * sizeof(uint32_t) + header[2];
+            if (needed != fileSize) return false;
+
+            std::string savedRoot(header[0], '\0');
+            if (!in.read(&savedRoot[0], savedRoot.size()) || savedRoot != root) return false;
+
+            std::vector<uint32_t> savedOffsets((size_t)header[1] + 1);
+            std::string savedPool(header[2], '\0');
+            if (!in.read(reinterpret_cast<char*>(savedOffsets.data()), savedOffsets.size() * sizeof(uint32_t))) return false;
+            if (!in.read(&savedPool[0], savedPool.size())) return false;
+            for (size_t i = 0; i + 1 < savedOffsets.size(); ++i) {
+                if (savedOffsets[i] > savedOffsets[i + 1]) return false;
+            }
+            if (savedOffsets.empty() || savedOffsets.back() != savedPool.size()) return false;
+
+            offsets = std::move(savedOffsets);
+            pool = std::move(savedPool);
+            computeMasks();
+            return true;
+        }
+};
+
+// Scores `path` against a lowercase `query`; higher is better and -1 means it is not a
+// subsequence. The query is matched right to left so hits prefer the file name, and matches
+// that are consecutive or start a word earn a bonus. This is a plain scalar loop; the speed
+// comes from the mask prefilter in FuzzyFinder::refresh, which only lets it see likely hits.
+int fuzzyScore(std::string_view path, std::string_view query) {
+    size_t nameStart = path.rfind('/') + 1;  // npos + 1 wraps to 0 for top-level files
+    int score = 0;
+    int queryIndex = (int)query.size() - 1;
+    int previousMatch = -2;
+    for (int i = (int)path.size() - 1; i >= 0 && queryIndex >= 0; --i) {
+        unsigned char c = path[i];
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+        if (c != (unsigned char)query[queryIndex]) continue;
+
+        score += 16;
+        if (previousMatch == i + 1) score += 24;  // Consecutive with the match to its right
+        char before = i > 0 ? path[i - 1] : '/';
+        if (before == '/' || before == '_' || before == '-' || before == '.' || before == ' ') score += 20;
+        if ((size_t)i >= nameStart) score += 8;
+        previousMatch = i;
+        --queryIndex;
+    }
+    if (queryIndex >= 0) return -1;
+    return score * 8 - (int)path.size();  // Shorter paths win ties
+}
+
+// Ctrl+P palette: type part of a path and pick from the best matches of the whole project.
+// Created on the first Ctrl+P. A background thread loads the saved index, then rebuilds it to pick up changes.
+class FuzzyFinder {
+    private:
+        fs::path root;
+        std::string cachePath;
+
+        mutable std::mutex indexLock;
+        std::shared_ptr<const PathIndex> index;  // Swapped in whole when a rebuild finishes
+        std::atomic<int> indexGeneration{0};
+        std::atomic<bool> building{true};
+        std::atomic<bool> cancelled{false};
+        std::thread builder;
+
+        std::string query;
+        std::shared_ptr<const PathIndex> rankedIndex;  // The index `results` refers to
+        std::vector<std::pair<int, int>> results;      // (score, path id), best first
+        int resultsGeneration = -1;
+        int selectedIndex = 0;
+        int scrollOffset = 0;
+        int screenRows = 0;
+        int screenCols = 0;
+
+        const WORD BAR_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+        const WORD TEXT_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+        const WORD SELECTED_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+
+        int listRows() const { return std::max(1, screenRows - 2); }
+
+        std::shared_ptr<const PathIndex> currentIndex() const {
+            std::lock_guard<std::mutex> guard(indexLock);
+            return index;
+        }
+
+        std::string fitLine(const std::string& text) const {
+            if ((int)text.size() >= screenCols) return text.substr(0, screenCols);
+            return text + std::string(screenCols - text.size(), ' ');
+        }
+
+    public:
+        // An empty `indexFile` means the index is neither loaded from nor saved to disk
+        FuzzyFinder(const fs::path& projectRoot, const std::string& indexFile)
+            : root(projectRoot), cachePath(indexFile) {
+            builder = std::thread([this] {
+                auto saved = std::make_shared<PathIndex>();
+                bool loaded = false;
+                try {
+                    loaded = !cachePath.empty() && saved->load(cachePath, root.generic_string());
+                } catch (const std::exception&) {
+                    loaded = false;  // A cache we cannot read just means a cold rebuild
+                }
+                if (loaded) {
+                    {
+                        std::lock_guard<std::mutex> guard(indexLock);
+                        index = saved;
+                    }
+                    ++indexGeneration;
+                }
+
+                auto fresh = std::make_shared<PathIndex>(PathIndex::build(root, cancelled));
+                if (cancelled) return;
+                if (!cachePath.empty()) fresh->save(cachePath, root.generic_string());
+                {
+                    std::lock_guard<std::mutex> guard(indexLock);
+                    index = fresh;
+                }
+                ++indexGeneration;
+                building = false;
+            });
+        }
+
+        ~FuzzyFinder() {
+            cancelled = true;
+            builder.join();
+        }
+
+        FuzzyFinder(const FuzzyFinder&) = delete;
+        FuzzyFinder& operator=(const FuzzyFinder&) = delete;
+
+        // Called when the palette opens
+        void open(int rows, int cols) {
+            screenRows = rows;
+            screenCols = cols;
+            query.clear();
+            refresh();
+        }
+
+        // Takes a new window size. A taller list needs more ranked paths; otherwise the selection is just kept on screen.
+        void resize(int rows, int cols) {
+            bool taller = rows > screenRows;
+            screenRows = rows;
+            screenCols = cols;
+            if (taller) refresh();
+            else moveSelection(0);
+        }
+
+        bool isBuilding() const { return building; }
+
+        // Re-ranks against the newest index if a background rebuild swapped one in
+        bool refreshIfIndexChanged() {
+            if (resultsGeneration == indexGeneration) return false;
+            refresh();
+            return true;
+        }
+
+        // Ranks every path against the query, keeping only the best screenful in a min-heap
+        void refresh() {
+            resultsGeneration = indexGeneration;
+            selectedIndex = 0;
+            scrollOffset = 0;
+            results.clear();
+            rankedIndex = currentIndex();
+            if (!rankedIndex) return;
+            const PathIndex& paths = *rankedIndex;
+
+            std::string lowered = query;
+            uint64_t queryMask = 0;
+            for (char& c : lowered) {
+                if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+                queryMask |= charClassMask((unsigned char)c);
+            }
+
+            size_t keep = (size_t)listRows() * 4;  // A few pages to scroll through
+            auto worseFirst = [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first > b.first; };
+            for (size_t i = 0; i < paths.size(); ++i) {
+                if ((paths.mask(i) & queryMask) != queryMask) continue;
+                int score = fuzzyScore(paths.path(i), lowered);
+                if (score < 0) continue;
+                if (results.size() < keep) {
+                    results.emplace_back(score, (int)i);
+                    std::push_heap(results.begin(), results.end(), worseFirst);
+                } else if (score > results.front().first) {
+                    std::pop_heap(results.begin(), results.end(), worseFirst);
+                    results.back() = {score, (int)i};
+                    std::push_heap(results.begin(), results.end(), worseFirst);
+                }
+            }
+            std::sort_heap(results.begin(), results.end(), worseFirst);
+        }
+
+        void typeChar(char c) {
+            query += c;
+            refresh();
+        }
+
+        void backspace() {
+            if (query.empty()) return;
+            query.pop_back();
+            refresh();
+        }
+
+        void moveSelection(int delta) {
+            if (results.empty()) return;
+            selectedIndex = std::max(0, std::min((int)results.size() - 1, selectedIndex + delta));
+            if (selectedIndex < scrollOffset) scrollOffset = selectedIndex;
+            else if (selectedIndex >= scrollOffset + listRows()) scrollOffset = selectedIndex - listRows() + 1;
+        }
+
+        fs::path getSelectedPath() const {
+            if (!rankedIndex || results.empty()) return fs::path();
+            return root / fs::path(std::string(rankedIndex->path(results[selectedIndex].second)));
+        }
+
+        void draw() {
+            const PathIndex* paths = rankedIndex.get();
+            size_t indexed = currentIndex() ? currentIndex()->size() : 0;
+            screen.beginFrame(screenRows, screenCols);
+
+            // Prompt line
+            std::string prompt = " Open: " + query;
+            screen.text(0, 0, fitLine(prompt), BAR_COLOR);
+
+            // Best matches, best first
+            for (int i = 0; i < listRows(); ++i) {
+                int resultIndex = scrollOffset + i;
+                if (!paths || resultIndex >= (int)results.size()) break;
+                bool selected = resultIndex == selectedIndex;
+                screen.text(i + 1, 0, fitLine((selected ? "> " : "  ") + std::string(paths->path(results[resultIndex].second))),
+                            selected ? SELECTED_COLOR : TEXT_COLOR);
+            }
+
+            // Status bar / help line
+            std::string status = " " + std::to_string(results.size()) + " shown of " +
+                                 std::to_string(indexed) + " files" +
+                                 (building ? "  [indexing...]" : "") + "  [Enter] Open  [Esc] Cancel";
+            screen.text(screenRows - 1, 0, fitLine(status), BAR_COLOR);
+            screen.setCursor(0, std::min(screenCols - 1, (int)prompt.size()));
+        }
+};
+
+// === Soft Wrap ===
+
+// Where each line breaks when soft wrap is on, plus a Fenwick tree over the number of screen rows
+// each line takes, so a screen row maps to (line, segment) and back in O(log n) even on huge
+// files. Breakpoints are worked out on demand and cached per line: an edit drops that line's
+// cache, a new width drops them all. A line that has not been laid out yet counts the rows its
+// length needs (exact for unbroken text, at most a little short for prose), so the tree is always
+// usable and the lines that are actually drawn get exact as they are drawn.
+class WrapLayout {
+    private:
+        int width = 0;                          // Text columns per screen row (0 = inactive)
+        std::vector<std::vector<int>> breaks;   // Start column of every segment after the first
+        std::vector<char> laidOut;              // Whether breaks[line] is up to date
+        std::vector<int> rowCounts;             // Screen rows each line takes
+        std::vector<int> tree;                  // Fenwick tree over rowCounts, 1-based
+
+        int estimate(const std::string& line) const {
+            return std::max(1, ((int)line.size() + width - 1) / width);
+        }
+
+        void addRows(int line, int delta) {
+            for (int i = line + 1; i < (int)tree.size(); i += i & -i) tree[i] += delta;
+        }
+
+        void setRows(int line, int count) {
+            if (count == rowCounts[line]) return;
+            addRows(line, count - rowCounts[line]);
+            rowCounts[line] = count;
+        }
+
+        // O(n) build: every node passes its sum on to its parent
+        void rebuildTree() {
+            int n = (int)rowCounts.size();
+            tree.assign(n + 1, 0);
+            for (int i = 1; i <= n; ++i) {
+                tree[i] += rowCounts[i - 1];
+                int parent = i + (i & -i);
+                if (parent <= n) tree[parent] += tree[i];
+            }
+        }
+
+    public:
+        bool active() const { return width > 0; }
+
+        // Matches the layout to the document and the text width. A new width only re-estimates
+        // the row counts; lines are laid out again when they are needed (the visible ones first).
+        void sync(const std::vector<std::string>& lines, int textWidth) {
+            textWidth = std::max(1, textWidth);
+            if (textWidth == width && rowCounts.size() == lines.size()) return;
+            width = textWidth;
+            breaks.resize(lines.size());
+            for (auto& lineBreaks : breaks) lineBreaks.clear();
+            laidOut.assign(lines.size(), 0);
+            rowCounts.resize(lines.size());
+            for (size_t i = 0; i < lines.size(); ++i) rowCounts[i] = estimate(lines[i]);
+            rebuildTree();
+        }
+
+        // Forgets everything; the next sync() starts over
+        void reset() {
+            width = 0;
+            breaks.clear();
+            laidOut.clear();
+            rowCounts.clear();
+            tree.clear();
+        }
+
+        void lineChanged(const std::vector<std::string>& lines, int row) {
+            if (!active() || row < 0 || row >= (int)laidOut.size()) return;
+            laidOut[row] = 0;
+            setRows(row, estimate(lines[row]));
+        }
+
+        void linesInserted(const std::vector<std::string>& lines, int row, int count) {
+            if (!active() || row < 0 || row > (int)laidOut.size() || count <= 0) return;
+            breaks.insert(breaks.begin() + row, count, std::vector<int>());
+            laidOut.insert(laidOut.begin() + row, count, 0);
+            rowCounts.insert(rowCounts.begin() + row, count, 1);
+            for (int i = row; i < row + count; ++i) rowCounts[i] = estimate(lines[i]);
+            rebuildTree();
+        }
+
+        void linesErased(int row, int count) {
+            if (!active() || row < 0 || count <= 0) return;
+            count = std::min(count, (int)laidOut.size() - row);
+            if (count <= 0) return;
+            breaks.erase(breaks.begin() + row, breaks.begin() + row + count);
+            laidOut.erase(laidOut.begin() + row, laidOut.begin() + row + count);
+            rowCounts.erase(rowCounts.begin() + row, rowCounts.begin() + row + count);
+            rebuildTree();
+        }
+
+        // Breaks a line at the last space that fits each row, or mid-word if a word is longer than a row
+        const std::vector<int>& layout(const std::vector<std::string>& lines, int line) {
+            if (!laidOut[line]) {
+                const std::string& text = lines[line];
+                std::vector<int>& lineBreaks = breaks[line];
+                lineBreaks.clear();
+                int length = (int)text.size();
+                for (int start = 0; length - start > width;) {
+                    int cut = start + width;
+                    for (int k = cut; k > start + 1; --k) {
+                        if (text[k - 1] == ' ') { cut = k; break; }
+                    }
+                    lineBreaks.push_back(cut);
+                    start = cut;
+                }
+                laidOut[line] = 1;
+                setRows(line, (int)lineBreaks.size() + 1);
+            }
+            return breaks[line];
+        }
+
+        int rowsOf(int line) const { return rowCounts[line]; }
+        int totalRows() const { return rowOf((int)rowCounts.size()); }
+
+        // First screen row of `line`, counting from the top of the document
+        int rowOf(int line) const {
+            int sum = 0;
+            for (int i = line; i > 0; i -= i & -i) sum += tree[i];
+            return sum;
+        }
+
+        // Line and segment shown on document row `row` (clamped to the document)
+        std::pair<int, int> lineAtRow(int row) const {
+            int n = (int)rowCounts.size();
+            if (n == 0) return { 0, 0 };
+            row = std::max(0, row);
+            int line = 0;
+            int step = 1;
+            while (step * 2 <= n) step *= 2;
+            for (; step > 0; step /= 2) {
+                if (line + step <= n && tree[line + step] <= row) {
+                    line += step;
+                    row -= tree[line];
+                }
+            }
+            if (line >= n) return { n - 1, rowCounts[n - 1] - 1 };
+            return { line, row };
+        }
+
+        // Segment of `line` that shows column `col`
+        int segmentOf(const std::vector<std::string>& lines, int line, int col) {
+            const std::vector<int>& lineBreaks = layout(lines, line);
+            return (int)(std::upper_bound(lineBreaks.begin(), lineBreaks.end(), col) - lineBreaks.begin());
+        }
+
+        int segmentStart(const std::vector<std::string>& lines, int line, int segment) {
+            const std::vector<int>& lineBreaks = layout(lines, line);
+            return segment == 0 ? 0 : lineBreaks[std::min(segment, (int)lineBreaks.size()) - 1];
+        }
+
+        int segmentEnd(const std::vector<std::string>& lines, int line, int segment) {
+            const std::vector<int>& lineBreaks = layout(lines, line);
+            return segment < (int)lineBreaks.size() ? lineBreaks[segment] : (int)lines[line].size();
+        }
+};
+
+// === Character Classes ===
+
+// Which bytes of a 64-byte block belong to the classes the lexer cares about: bit i of a mask is
+// byte i of the block. With SSE2 (every x86-64 compiler has it) each 16 bytes are classified with a
+// handful of compares; elsewhere, or built with -DNITE_NO_SIMD, a lookup table does it a byte at a time.
+struct CharClassMasks {
+    uint64_t identifier = 0;   // A-Z a-z 0-9 _
+    uint64_t digit = 0;        // 0-9
+    uint64_t quote = 0;        // " '
+    uint64_t operators = 0;    // + - * / % = < > & | ^ ~ ! :
+    uint64_t space = 0;        // Space and tab
+    uint64_t slash = 0;        // /
+    uint64_t backslash = 0;    // \\ (escapes inside literals)
+};
+
+enum CharClass : uint8_t {
+    CHAR_IDENTIFIER = 1, CHAR_DIGIT = 2, CHAR_QUOTE = 4, CHAR_OPERATOR = 8, CHAR_SPACE = 16, CHAR_SLASH = 32, CHAR_BACKSLASH = 64
+};
+
+constexpr std::array<uint8_t, 256> buildCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; ++c) table[c] = table[c - 'a' + 'A'] = CHAR_IDENTIFIER;
+    for (int c = '0'; c <= '9'; ++c) table[c] = CHAR_IDENTIFIER | CHAR_DIGIT;
+    table['_'] = CHAR_IDENTIFIER;
+    table['"'] = table['\''] = CHAR_QUOTE;
+    for (char c : std::string_view("+-*/%=<>&|^~!:")) table[(unsigned char)c] = CHAR_OPERATOR;
+    table['/'] |= CHAR_SLASH;
+    table[' '] = table['\t'] = CHAR_SPACE;
+    table['\\'] = CHAR_BACKSLASH;
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = buildCharClassTable();
+
+inline uint8_t charClass(char c) { return CHAR_CLASSES[(unsigned char)c]; }
+
+// A letter or '_': the start of an identifier or keyword
+inline bool startsIdentifier(char c) { return (charClass(c) & (CHAR_IDENTIFIER | CHAR_DIGIT)) == CHAR_IDENTIFIER; }
+
+// Classifies the `count` (at most 64) bytes at p; bits past `count` stay clear
+inline void classifyBlock(const char* p, int count, CharClassMasks& masks) {
+    masks = CharClassMasks();
+#ifdef NITE_SSE2
+    // Only the 16-byte chunks holding text are classified; a short last one is read from a zeroed
+    // copy so nothing past the end of the text is touched
+    for (int shift = 0; shift < count; shift += 16) {
+        __m128i c;
+        if (count - shift >= 16) {
+            c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + shift));
+        } else {
+            alignas(16) char tail[16] = {};
+            std::memcpy(tail, p + shift, count - shift);
+            c = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+        auto is = [c](char ch) { return _mm_cmpeq_epi8(c, _mm_set1_epi8(ch)); };
+        auto bits = [shift](__m128i v) { return (uint64_t)(uint32_t)_mm_movemask_epi8(v) << shift; };
+
+        // Signed compares: bytes from 0x80 up are negative, so they fall outside every range
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i slash = is('/');
+        // ! % & * + - / : < = > ^ | ~ ; the ranges %-& *-+ <-> cover two or three of them each
+        __m128i operators = _mm_or_si128(_mm_or_si128(_mm_or_si128(is('!'), is('-')), _mm_or_si128(slash, is(':'))),
+                                         _mm_or_si128(_mm_or_si128(is('^'), is('|')), is('~')));
+        operators = _mm_or_si128(operators, _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('%' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('&' + 1))));
+        operators = _mm_or_si128(operators, _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('*' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('+' + 1))));
+        operators = _mm_or_si128(operators, _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('<' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('>' + 1))));
+
+        masks.identifier |= bits(_mm_or_si128(_mm_or_si128(letter, digit), is('_')));
+        masks.digit |= bits(digit);
+        masks.quote |= bits(_mm_or_si128(is('"'), is('\'')));
+        masks.operators |= bits(operators);
+        masks.space |= bits(_mm_or_si128(is(' '), is('\t')));
+        masks.slash |= bits(slash);
+        masks.backslash |= bits(is('\\'));
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        uint8_t classes = CHAR_CLASSES[(unsigned char)p[i]];
+        if (!classes) continue;
+        uint64_t bit = (uint64_t)1 << i;
+        if (classes & CHAR_IDENTIFIER) masks.identifier |= bit;
+        if (classes & CHAR_DIGIT) masks.digit |= bit;
+        if (classes & CHAR_QUOTE) masks.quote |= bit;
+        if (classes & CHAR_OPERATOR) masks.operators |= bit;
+        if (classes & CHAR_SPACE) masks.space |= bit;
+        if (classes & CHAR_SLASH) masks.slash |= bit;
+        if (classes & CHAR_BACKSLASH) masks.backslash |= bit;
+    }
+#endif
+}
+
+// Index of the lowest set bit (mask must not be 0)
+inline int lowestBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Finds class boundaries in one line with bit scans, classifying it a block at a time as the
+// lexer gets there (most lines fit in one block)
+class CharClassScanner {
+    private:
+        const char* text = nullptr;
+        int size = 0;
+        int blockStart = -1;       // Start of the classified block, -1 before the first
+        CharClassMasks masks;
+
+    public:
+        void reset(const char* lineText, int lineSize) {
+            text = lineText;
+            size = lineSize;
+            blockStart = -1;
+        }
+
+        // The first position at or after `from` whose byte is in pick(masks), or the line's size.
+        // pick may complement a class (~masks.identifier); bits past the end of the line are ignored.
+        template <typename Pick>
+        int find(int from, Pick pick) {
+            while (from < size) {
+                int start = from & ~63;
+                if (start != blockStart) {
+                    blockStart = start;
+                    classifyBlock(text + start, std::min(64, size - start), masks);
+                }
+                uint64_t hits = pick(masks) & (~(uint64_t)0 << (from - start));
+                if (hits) return std::min(size, start + lowestBit(hits));
+                from = start + 64;
+            }
+            return size;
+        }
+};
+
+// === Keyword Table ===
+
+// What a keyword is, which decides its color
+enum class KeywordCategory : uint8_t {
+    NONE, TYPE, TYPE_MODIFIER, CAST, CONTROL_FLOW, OPERATOR, MEMORY_MANAGEMENT, EXCEPTION_HANDLING,
+    OOP, TEMPLATE, NAMESPACE, COROUTINE, CONCEPT, BOOLEAN_LITERAL, NULL_LITERAL, PREPROCESSOR, MISC,
+    COUNT
+};
+
+struct Keyword {
+    std::string_view word;
+    KeywordCategory category;
+};
+
+// Every word the highlighter colors. Each word appears once: "if" and "else" are control flow,
+// directive names after '#' get the preprocessor color from the lexer itself.
+constexpr Keyword KEYWORDS[] = {
+    // **Built-in Types**
+    {"bool", KeywordCategory::TYPE}, {"char", KeywordCategory::TYPE}, {"char8_t", KeywordCategory::TYPE},
+    {"char16_t", KeywordCategory::TYPE}, {"char32_t", KeywordCategory::TYPE}, {"double", KeywordCategory::TYPE},
+    {"float", KeywordCategory::TYPE}, {"int", KeywordCategory::TYPE}, {"long", KeywordCategory::TYPE},
+    {"short", KeywordCategory::TYPE}, {"signed", KeywordCategory::TYPE}, {"unsigned", KeywordCategory::TYPE},
+    {"void", KeywordCategory::TYPE}, {"wchar_t", KeywordCategory::TYPE},
+
+    // **Type Modifiers**
+    {"const", KeywordCategory::TYPE_MODIFIER}, {"constexpr", KeywordCategory::TYPE_MODIFIER},
+    {"consteval", KeywordCategory::TYPE_MODIFIER}, {"constinit", KeywordCategory::TYPE_MODIFIER},
+    {"inline", KeywordCategory::TYPE_MODIFIER}, {"mutable", KeywordCategory::TYPE_MODIFIER},
+    {"volatile", KeywordCategory::TYPE_MODIFIER}, {"static", KeywordCategory::TYPE_MODIFIER},
+    {"register", KeywordCategory::TYPE_MODIFIER}, {"thread_local", KeywordCategory::TYPE_MODIFIER},
+
+    // **Casts and Introspection**
+    {"const_cast", KeywordCategory::CAST}, {"dynamic_cast", KeywordCategory::CAST},
+    {"reinterpret_cast", KeywordCategory::CAST}, {"static_cast", KeywordCategory::CAST},
+    {"decltype", KeywordCategory::CAST}, {"typeid", KeywordCategory::CAST},
+
+    // **Control Flow**
+    {"break", KeywordCategory::CONTROL_FLOW}, {"case", KeywordCategory::CONTROL_FLOW},
+    {"continue", KeywordCategory::CONTROL_FLOW}, {"default", KeywordCategory::CONTROL_FLOW},
+    {"do", KeywordCategory::CONTROL_FLOW}, {"else", KeywordCategory::CONTROL_FLOW},
+    {"for", KeywordCategory::CONTROL_FLOW}, {"goto", KeywordCategory::CONTROL_FLOW},
+    {"if", KeywordCategory::CONTROL_FLOW}, {"return", KeywordCategory::CONTROL_FLOW},
+    {"switch", KeywordCategory::CONTROL_FLOW}, {"while", KeywordCategory::CONTROL_FLOW},
+
+    // **Operator Words and Overloading**
+    {"and", KeywordCategory::OPERATOR}, {"and_eq", KeywordCategory::OPERATOR}, {"bitand", KeywordCategory::OPERATOR},
+    {"bitor", KeywordCategory::OPERATOR}, {"compl", KeywordCategory::OPERATOR}, {"not", KeywordCategory::OPERATOR},
+    {"not_eq", KeywordCategory::OPERATOR}, {"or", KeywordCategory::OPERATOR}, {"or_eq", KeywordCategory::OPERATOR},
+    {"xor", KeywordCategory::OPERATOR}, {"xor_eq", KeywordCategory::OPERATOR}, {"operator", KeywordCategory::OPERATOR},
+
+    // **Memory Management**
+    {"new", KeywordCategory::MEMORY_MANAGEMENT}, {"delete", KeywordCategory::MEMORY_MANAGEMENT},
+    {"sizeof", KeywordCategory::MEMORY_MANAGEMENT}, {"alignas", KeywordCategory::MEMORY_MANAGEMENT},
+    {"alignof", KeywordCategory::MEMORY_MANAGEMENT},
+
+    // **Exception Handling**
+    {"try", KeywordCategory::EXCEPTION_HANDLING}, {"catch", KeywordCategory::EXCEPTION_HANDLING},
+    {"throw", KeywordCategory::EXCEPTION_HANDLING},
+
+    // **Object-Oriented**
+    {"struct", KeywordCategory::OOP}, {"enum", KeywordCategory::OOP}, {"class", KeywordCategory::OOP},
+    {"friend", KeywordCategory::OOP}, {"private", KeywordCategory::OOP}, {"protected", KeywordCategory::OOP},
+    {"public", KeywordCategory::OOP}, {"this", KeywordCategory::OOP}, {"virtual", KeywordCategory::OOP},
+
+    // **Templates and Namespaces**
+    {"template", KeywordCategory::TEMPLATE}, {"typename", KeywordCategory::TEMPLATE}, {"using", KeywordCategory::TEMPLATE},
+    {"namespace", KeywordCategory::NAMESPACE}, {"export", KeywordCategory::NAMESPACE},
+
+    // **Literals**
+    {"true", KeywordCategory::BOOLEAN_LITERAL}, {"false", KeywordCategory::BOOLEAN_LITERAL},
+    {"nullptr", KeywordCategory::NULL_LITERAL},
+
+    // **Preprocessor**
+    {"define", KeywordCategory::PREPROCESSOR}, {"include", KeywordCategory::PREPROCESSOR},
+    {"undef", KeywordCategory::PREPROCESSOR}, {"ifdef", KeywordCategory::PREPROCESSOR},
+    {"ifndef", KeywordCategory::PREPROCESSOR}, {"elif", KeywordCategory::PREPROCESSOR},
+    {"endif", KeywordCategory::PREPROCESSOR}, {"pragma", KeywordCategory::PREPROCESSOR},
+
+    // **Coroutines and Concepts**
+    {"co_await", KeywordCategory::COROUTINE}, {"co_return", KeywordCategory::COROUTINE},
+    {"co_yield", KeywordCategory::COROUTINE},
+    {"concept", KeywordCategory::CONCEPT}, {"requires", KeywordCategory::CONCEPT},
+
+    // **Miscellaneous**
+    {"asm", KeywordCategory::MISC}, {"explicit", KeywordCategory::MISC}, {"extern", KeywordCategory::MISC},
+    {"noexcept", KeywordCategory::MISC}, {"static_assert", KeywordCategory::MISC}
+};
+
+constexpr int KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+constexpr int KEYWORD_SLOTS = 1024;        // Power of two, roomy enough that a seed is found quickly
+constexpr size_t KEYWORD_MAX_LENGTH = 16;  // "reinterpret_cast"; longer identifiers skip the lookup
+static_assert(KEYWORD_COUNT < 255, "keyword indexes are stored in a byte");
+
+// FNV-1a with a chosen starting value, so the build can try seeds until no two keywords share a slot
+constexpr uint32_t keywordHash(std::string_view word, uint32_t seed) {
+    uint32_t hash = seed;
+    for (char c : word) hash = (hash ^ (unsigned char)c) * 16777619u;
+    return (hash ^ (hash >> 16)) & (KEYWORD_SLOTS - 1);
+}
+
+// A collision-free slot table: slots[keywordHash(word, seed)] is the keyword's index, or 255 for none
+struct KeywordTable {
+    uint32_t seed = 0;
+    std::array<uint8_t, KEYWORD_SLOTS> slots{};
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table;
+    for (uint32_t seed = 2166136261u; seed < 2166136261u + 4096; ++seed) {
+        for (auto& slot : table.slots) slot = 255;
+        bool collided = false;
+        for (int i = 0; i < KEYWORD_COUNT && !collided; ++i) {
+            uint8_t& slot = table.slots[keywordHash(KEYWORDS[i].word, seed)];
+            if (slot != 255) collided = true;
+            else slot = (uint8_t)i;
+        }
+        if (!collided) {
+            table.seed = seed;
+            return table;
+        }
+    }
+    return table;  // seed 0: caught by the static_assert below
+}
+
+// Built by the compiler, so the editor never hashes the keyword list at startup
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+static_assert(KEYWORD_TABLE.seed != 0, "no collision-free seed for the keyword table; raise KEYWORD_SLOTS");
+
+// One hash, one table read and one compare; no allocation
+inline KeywordCategory keywordCategory(std::string_view word) {
+    if (word.size() > KEYWORD_MAX_LENGTH) return KeywordCategory::NONE;
+    uint8_t index = KEYWORD_TABLE.slots[keywordHash(word, KEYWORD_TABLE.seed)];
+    if (index == 255 || KEYWORDS[index].word != word) return KeywordCategory::NONE;
+    return KEYWORDS[index].category;
+}
+
+// Category colors, through pointers so they follow the config and theme as they are reloaded
+WORD* const KEYWORD_COLORS[(int)KeywordCategory::COUNT] = {
+    &DEFAULT_COLOR, &TYPE_COLOR, &TYPE_MODIFIER_COLOR, &CAST_COLOR, &CONTROL_FLOW_COLOR, &OPERATOR_COLOR,
+    &MEMORY_MANAGEMENT_COLOR, &EXCEPTION_HANDLING_COLOR, &OOP_COLOR, &TEMPLATE_COLOR, &NAMESPACE_COLOR,
+    &COROUTINE_COLOR, &CONCEPT_COLOR, &BOOLEAN_LITERAL_COLOR, &NULL_COLOR, &PREPROCESSOR_COLOR, &MISC_COLOR
+};
+
+inline WORD keywordColor(KeywordCategory category) {
+    return *KEYWORD_COLORS[(int)category];
+}
+
+// === Incremental Lexing ===
+
+// What the lexer carries from the end of one line into the next
+struct LexState {
+    enum Mode : uint8_t { CODE, BLOCK_COMMENT, LINE_COMMENT, STRING, CHAR_LITERAL, RAW_STRING };
+    uint8_t mode = CODE;
+    bool directive = false;         // Inside a preprocessor directive continued with a backslash
+    uint8_t delimiterLength = 0;    // Raw strings: the delimiter between the opening quote and '('
+    char delimiter[16] = {};
+
+    bool operator==(const LexState& other) const {
+        return mode == other.mode && directive == other.directive && delimiterLength == other.delimiterLength
+            && std::memcmp(delimiter, other.delimiter, delimiterLength) == 0;
+    }
+    bool operator!=(const LexState& other) const { return !(*this == other); }
+};
+
+// Length of the longest operator starting at p (maximal munch, so "<<=" is one token, not "<" and
+// "<="), or 0 if none does. One switch on the first byte, then at most two more bytes looked at.
+inline int operatorLength(const char* p, const char* end) {
+    char next = p + 1 < end ? p[1] : '\0';
+    char third = p + 2 < end ? p[2] : '\0';
+    switch (*p) {
+        case '+': return next == '+' || next == '=' ? 2 : 1;
+        case '-':
+            if (next == '>') return third == '*' ? 3 : 2;
+            return next == '-' || next == '=' ? 2 : 1;
+        case '&': return next == '&' || next == '=' ? 2 : 1;
+        case '|': return next == '|' || next == '=' ? 2 : 1;
+        case '<':
+            if (next == '<') return third == '=' ? 3 : 2;
+            if (next == '=') return third == '>' ? 3 : 2;
+            return 1;
+        case '>':
+            if (next == '>') return third == '=' ? 3 : 2;
+            return next == '=' ? 2 : 1;
+        case '*': case '/': case '%': case '^': case '!': case '=':
+            return next == '=' ? 2 : 1;
+        case '~': return 1;
+        case ':': return next == ':' ? 2 : 0;
+        default: return 0;
+    }
+}
+
+// Token colors for the lines being drawn, and checkpoints to start lexing from anywhere else.
+//
+// A checkpoint is the lexer state at the start of a line, kept about every CHECKPOINT_LINES lines
+// (a few bytes per checkpoint, so even huge files need little memory). The state a line starts in
+// is found by lexing forward from the nearest checkpoint above it, so spans for a line after a jump
+// cost at most CHECKPOINT_LINES lines of lexing. Checkpoints are laid down ahead of time by fillSome().
+//
+// An edit marks the first checkpoint below it as suspect. Checking it relexes only the lines up to
+// it: if the state arriving there is unchanged the edit did not open or close a comment or string
+// and every checkpoint below still holds; otherwise it is corrected and the next one becomes
+// suspect, so "/*" recolors everything below it while typing inside a line costs a few lines.
+//
+// Spans are kept for the lines on and around the screen in a fixed ring of slots whose buffers are
+// reused. A slot remembers the state its line was lexed from: after an edit above it, the line is
+// only lexed again if the state it now starts in differs. Until then cachedSpans() still hands out
+// the old spans, marked as not current, so a frame can be drawn without waiting for the lexer.
+//
+// All of this is done by the highlighter thread (see HighlightWorker); the editor only reads spans.
+class SyntaxCache {
+    public:
+        static constexpr int SLOT_COUNT = 256;     // Several screens' worth of lines
+        static constexpr int KEPT_LINES = SLOT_COUNT / 2;  // Most lines keep() should be asked to hold
+
+    private:
+        static constexpr int CHECKPOINT_LINES = 64;
+
+        struct Checkpoint {
+            int line;                              // The state is the one this line starts in
+            LexState state;
+            bool suspect;                          // An edit above may have changed it
+        };
+        std::vector<Checkpoint> checkpoints{ Checkpoint{ 0, LexState(), false } };
+        int verified = 1;                          // Checkpoints [0, verified) are known to be right
+
+        struct Slot {
+            int row = -1;                          // Line whose spans these are, -1 if free
+            LexState start;                        // State the line was lexed from
+            LexState end;                          // State after its last character
+            bool trusted = false;                  // Whether start is still right for the document
+            bool textChanged = false;              // The line was edited since it was lexed
+            std::vector<StyleSpan> spans;
+        };
+        std::vector<Slot> slots;
+        int nextSlot = 0;                          // Slots are handed out round robin, evicting the oldest
+        int keepFrom = 0, keepTo = 0;              // Lines whose slots are not evicted (see keep())
+
+        Slot* slotOf(int row) {
+            for (Slot& slot : slots) {
+                if (slot.row == row) return &slot;
+            }
+            return nullptr;
+        }
+
+        Slot& claimSlot(int row) {
+            if (slots.empty()) {
+                slots.resize(SLOT_COUNT);
+                for (Slot& slot : slots) slot.spans.reserve(32);
+            }
+            for (int tries = 1; tries < SLOT_COUNT; ++tries) {
+                int held = slots[nextSlot].row;
+                if (held < keepFrom || held >= keepTo) break;
+                nextSlot = (nextSlot + 1) % SLOT_COUNT;
+            }
+            Slot& slot = slots[nextSlot];
+            nextSlot = (nextSlot + 1) % SLOT_COUNT;
+            slot.row = row;
+            return slot;
+        }
+
+        // The first checkpoint below `row` (index into checkpoints)
+        int checkpointAfter(int row) const {
+            return (int)(std::upper_bound(checkpoints.begin(), checkpoints.end(), row,
+                                          [](int line, const Checkpoint& checkpoint) { return line < checkpoint.line; })
+                         - checkpoints.begin());
+        }
+
+        // States after `row` may have changed: the first checkpoint below it has to be checked again
+        void suspectAfter(int row) {
+            int next = checkpointAfter(row);
+            if (next < (int)checkpoints.size()) {
+                checkpoints[next].suspect = true;
+                verified = std::min(verified, next);
+            }
+        }
+
+        // Forgets checkpoints and slots past the end of a document that shrank without telling us
+        void syncSize(int lineCount) {
+            while (checkpoints.size() > 1 && checkpoints.back().line >= lineCount) checkpoints.pop_back();
+            verified = std::min(verified, (int)checkpoints.size());
+            for (Slot& slot : slots) {
+                if (slot.row >= lineCount) slot.row = -1;
+            }
+        }
+
+        // Lexes from the last verified checkpoint to the suspect one after it and corrects it if
+        // needed, laying down new checkpoints on the way where inserted lines left a wide gap
+        template <typename Lex>
+        void verifyNext(const std::vector<std::string>& lines, Lex& lex) {
+            int from = checkpoints[verified - 1].line;
+            LexState state = checkpoints[verified - 1].state;
+            for (int line = from; line < checkpoints[verified].line; ++line) {
+                if (line > from && (line - from) % CHECKPOINT_LINES == 0) {
+                    checkpoints.insert(checkpoints.begin() + verified, Checkpoint{ line, state, false });
+                    ++verified;
+                }
+                lex(lines[line], state, nullptr);
+            }
+            Checkpoint& next = checkpoints[verified];
+            if (next.state != state) {
+                next.state = state;
+                if (verified + 1 < (int)checkpoints.size()) checkpoints[verified + 1].suspect = true;
+            }
+            next.suspect = false;
+            while (verified < (int)checkpoints.size() && !checkpoints[verified].suspect) ++verified;
+        }
+
+        // Adds a checkpoint CHECKPOINT_LINES below the last one (all checkpoints must be verified)
+        template <typename Lex>
+        void extend(const std::vector<std::string>& lines, Lex& lex) {
+            Checkpoint last = checkpoints.back();
+            LexState state = last.state;
+            for (int line = last.line; line < last.line + CHECKPOINT_LINES; ++line) lex(lines[line], state, nullptr);
+            checkpoints.push_back(Checkpoint{ last.line + CHECKPOINT_LINES, state, false });
+            verified = (int)checkpoints.size();
+        }
+
+        // The state line `row` starts in, from the nearest checkpoint above it
+        template <typename Lex>
+        LexState stateAt(const std::vector<std::string>& lines, int row, Lex& lex) {
+            while (verified < (int)checkpoints.size() && checkpoints[verified].line <= row) verifyNext(lines, lex);
+            while (verified == (int)checkpoints.size() && checkpoints.back().line + CHECKPOINT_LINES <= row) extend(lines, lex);
+            const Checkpoint& nearest = checkpoints[checkpointAfter(row) - 1];
+            LexState state = nearest.state;
+            for (int line = nearest.line; line < row; ++line) lex(lines[line], state, nullptr);
+            return state;
+        }
+
+        // The state line `row` starts in: the end of the line above if it is in a trusted slot
+        template <typename Lex>
+        LexState stateBefore(const std::vector<std::string>& lines, int row, Lex& lex) {
+            if (row == 0) return LexState();
+            Slot* above = slotOf(row - 1);
+            if (above && above->trusted && !above->textChanged) return above->end;
+            return stateAt(lines, row, lex);
+        }
+
+    public:
+        // Token spans of the whole of line `row`. `lex(line, state, spans)` lexes one line from
+        // `state`, leaves the end state in it and appends spans unless `spans` is null.
+        template <typename Lex>
+        const std::vector<StyleSpan>& lineSpans(const std::vector<std::string>& lines, int row, Lex lex) {
+            syncSize((int)lines.size());
+            Slot* slot = slotOf(row);
+            if (slot && slot->trusted && !slot->textChanged) return slot->spans;
+
+            LexState state = stateBefore(lines, row, lex);
+            if (slot && !slot->textChanged && slot->start == state) {
+                slot->trusted = true;  // Starts where it did before the edit above, so it reads the same
+                return slot->spans;
+            }
+            if (!slot) slot = &claimSlot(row);
+            slot->start = state;
+            slot->spans.clear();
+            lex(lines[row], state, &slot->spans);
+            slot->end = state;
+            slot->trusted = true;
+            slot->textChanged = false;
+            return slot->spans;
+        }
+
+        // Spans of line `row` as last lexed, without lexing anything: null if there are none, and
+        // `current` tells whether they still match the document
+        const std::vector<StyleSpan>* cachedSpans(int row, bool& current) {
+            Slot* slot = slotOf(row);
+            current = slot && slot->trusted && !slot->textChanged;
+            return slot ? &slot->spans : nullptr;
+        }
+
+        // Lines [from, to) keep their slots while others are lexed; no more than KEPT_LINES of them
+        void keep(int from, int to) {
+            keepFrom = std::max(0, from);
+            keepTo = std::min(to, keepFrom + KEPT_LINES);
+        }
+
+        // Whether some checkpoints are suspect or missing
+        bool hasBackgroundWork(int lineCount) const {
+            return verified < (int)checkpoints.size() || checkpoints.back().line + CHECKPOINT_LINES < lineCount;
+        }
+
+        // Whether the state line `row` starts in can be had by lexing at most CHECKPOINT_LINES lines
+        bool reaches(int row) const {
+            return verified < (int)checkpoints.size() ? checkpoints[verified].line > row
+                                                      : checkpoints.back().line + CHECKPOINT_LINES > row;
+        }
+
+        // Checks and lays down checkpoints until they reach line `upTo` (all of them by default),
+        // or until `deadline` passes
+        template <typename Lex>
+        void fillSome(const std::vector<std::string>& lines, Lex lex, std::chrono::steady_clock::time_point deadline,
+                      int upTo = INT_MAX) {
+            syncSize((int)lines.size());
+            while (hasBackgroundWork((int)lines.size()) && !reaches(upTo) && std::chrono::steady_clock::now() < deadline) {
+                if (verified < (int)checkpoints.size()) verifyNext(lines, lex);
+                else extend(lines, lex);
+            }
+        }
+
+        void lineChanged(int row) {
+            suspectAfter(row);
+            for (Slot& slot : slots) {
+                if (slot.row == row) slot.textChanged = true;
+                if (slot.row > row) slot.trusted = false;
+            }
+        }
+
+        // New lines go before the old line `row`; the state that line starts in is unchanged
+        void linesInserted(int row, int count) {
+            if (row < 0 || count <= 0) return;
+            for (int i = checkpointAfter(row); i < (int)checkpoints.size(); ++i) checkpoints[i].line += count;
+            suspectAfter(row);
+            for (Slot& slot : slots) {
+                if (slot.row >= row) {
+                    slot.row += count;
+                    slot.trusted = false;
+                }
+            }
+        }
+
+        // Checkpoints inside the erased lines (and the one just after them) go
+        void linesErased(int row, int count) {
+            if (row < 0 || count <= 0) return;
+            int first = checkpointAfter(row);
+            int last = checkpointAfter(row + count);
+            checkpoints.erase(checkpoints.begin() + first, checkpoints.begin() + last);
+            for (int i = first; i < (int)checkpoints.size(); ++i) checkpoints[i].line -= count;
+            verified = std::min(verified, first);
+            suspectAfter(row);
+            for (Slot& slot : slots) {
+                if (slot.row >= row + count) {
+                    slot.row -= count;
+                    slot.trusted = false;
+                } else if (slot.row >= row) {
+                    slot.row = -1;
+                }
+            }
+        }
+
+        // New document, or new colors
+        void reset() {
+            checkpoints.assign(1, Checkpoint{ 0, LexState(), false });
+            verified = 1;
+            for (Slot& slot : slots) slot.row = -1;
+        }
+};
+
+// === Background Highlighting ===
+
+// Runs highlighting on a thread of its own, one slice at a time, while the editor waits for keys.
+//
+// The editor thread holds the document mutex whenever it may change the text, which is all the
+// time except inside idle(). Slices run with the mutex held, so they never see a half-made edit,
+// and each stops after SLICE; a key that arrives mid-slice waits at most that long. Frames are
+// drawn from whatever spans are cached, and idle() returns early when a slice reports that the
+// lines on screen have been brought up to date, so the editor can draw them again.
+class HighlightWorker {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr std::chrono::milliseconds SLICE{ 2 };
+
+        // What a slice got done: whether the lines on screen are now current, and whether any work is left
+        struct Progress {
+            bool delivered;
+            bool more;
+        };
+
+    private:
+        std::thread thread;
+        std::mutex mutex;                   // Guards the flags below
+        std::condition_variable wake;       // The editor went idle, or the worker is to stop
+        std::condition_variable changed;    // Something the idle editor is waiting for happened
+        bool open = false;                  // The editor is idle and has let go of the document
+        bool delivered = false;             // A slice brought the lines on screen up to date
+        bool stopping = false;
+        std::mutex* document = nullptr;
+        std::function<Progress(Clock::time_point)> slice;
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return open || stopping; });
+                if (stopping) return;
+                lock.unlock();
+                Progress progress;
+                {
+                    std::lock_guard<std::mutex> text(*document);
+                    progress = slice(Clock::now() + SLICE);
+                }
+                lock.lock();
+                if (progress.delivered) delivered = true;
+                if (!progress.more) open = false;  // Nothing left until the editor changes something
+                if (progress.delivered || !progress.more) changed.notify_one();
+            }
+        }
+
+    public:
+        ~HighlightWorker() { stop(); }
+
+        // `work(deadline)` is called with `documentMutex` held and should return by the deadline
+        void start(std::mutex& documentMutex, std::function<Progress(Clock::time_point)> work) {
+            if (thread.joinable()) return;
+            document = &documentMutex;
+            slice = std::move(work);
+            stopping = false;
+            thread = std::thread([this] { run(); });
+        }
+
+        // The caller must not hold the document mutex, or a slice waiting for it never finishes
+        void stop() {
+            if (!thread.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        // Editor thread, holding the document through `documentLock`: lets go of it and runs slices
+        // for up to `timeout`, coming back sooner if the lines on screen arrive (then it returns true)
+        // or there is nothing left to do. The document is locked again on return.
+        bool idle(std::unique_lock<std::mutex>& documentLock, std::chrono::milliseconds timeout) {
+            documentLock.unlock();
+            bool arrived;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                open = true;
+                wake.notify_one();
+                changed.wait_for(lock, timeout, [this] { return delivered || !open; });
+                arrived = delivered;
+                delivered = false;
+                open = false;  // No new slices; one already running finishes before the lock below returns
+            }
+            documentLock.lock();
+            return arrived;
+        }
+};
+
+// === Performance Governor ===
+
+// Times every editor frame and the parts of it that grow with the text (syntax highlighting,
+// the watch/search overlays, the status bar's match count). When a frame runs over
+// frameBudgetMs, the most expensive part that is still at full detail is cut back:
+//   - HIGHLIGHT: lines over longLineLimitKB are drawn without syntax colors
+//   - OVERLAYS: watch terms and search hits are not painted while the view is scrolling
+//   - MATCH_COUNT: the match counter scans at most matchCountLines lines per frame ("N+ matches")
+// Everything comes back once no key has arrived for idleRestoreMs.
+class PerformanceGovernor {
+    public:
+        enum Stage { HIGHLIGHT, OVERLAYS, MATCH_COUNT, STAGE_COUNT };
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        Clock::time_point frameStart;
+        Clock::time_point lastFrame;            // When the last editor frame finished
+        double stageMs[STAGE_COUNT] = {};       // Time spent in each stage during this frame
+        bool reduced[STAGE_COUNT] = {};
+        bool scrolling = false;                 // Whether this frame shows a different part of the file
+
+    public:
+        void beginFrame(bool viewMoved) {
+            frameStart = Clock::now();
+            std::fill(std::begin(stageMs), std::end(stageMs), 0.0);
+            scrolling = viewMoved;
+        }
+
+        // Adds the time since `since` to a stage; callers take Clock::now() before the work
+        void charge(Stage stage, Clock::time_point since) {
+            stageMs[stage] += std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+        }
+
+        void endFrame() {
+            lastFrame = Clock::now();
+            double frameMs = std::chrono::duration<double, std::milli>(lastFrame - frameStart).count();
+            if (!governorEnabled || frameMs <= frameBudgetMs) return;
+            int worst = -1;
+            for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+                if (!reduced[stage] && stageMs[stage] > 0 && (worst < 0 || stageMs[stage] > stageMs[worst])) worst = stage;
+            }
+            if (worst >= 0) reduced[worst] = true;
+        }
+
+        bool isReducing() const {
+            return reduced[HIGHLIGHT] || reduced[OVERLAYS] || reduced[MATCH_COUNT];
+        }
+
+        // Brings every feature back if nothing has been drawn for idleRestoreMs; true if it did
+        bool restoreIfIdle() {
+            if (!isReducing() || Clock::now() - lastFrame < std::chrono::milliseconds(idleRestoreMs)) return false;
+            restore();
+            return true;
+        }
+
+        void restore() { std::fill(std::begin(reduced), std::end(reduced), false); }
+
+        bool skipHighlight(size_t lineLength) const {
+            return reduced[HIGHLIGHT] && lineLength > (size_t)longLineLimitKB * 1024;
+        }
+
+        bool skipOverlays() const { return reduced[OVERLAYS] && scrolling; }
+
+        // Lines the match counter may scan this frame, or -1 for the whole document
+        int matchCountLimit() const { return reduced[MATCH_COUNT] ? matchCountLines : -1; }
+};
+
+// === Minimap ===
+
+// What the minimap knows about one line: how much text it holds and what is marked on it
+struct MinimapLine {
+    uint16_t ink = 0;         // Non-blank characters (capped)
+    uint8_t flags = 0;
+
+    static constexpr uint8_t MATCH = 1;   // Has a hit of the active search
+    static constexpr uint8_t WATCH = 2;   // Has a watch-list term
+    static constexpr uint8_t EDITED = 4;  // Changed since the file was opened
+};
+
+// Sums of MinimapLine values over a run of lines
+struct MinimapSummary {
+    int lines = 0;
+    long long ink = 0;
+    int matches = 0;          // Lines with each flag
+    int watches = 0;
+    int edits = 0;
+
+    void add(const MinimapLine& line, int sign) {
+        lines += sign;
+        ink += sign * (long long)line.ink;
+        matches += sign * ((line.flags & MinimapLine::MATCH) ? 1 : 0);
+        watches += sign * ((line.flags & MinimapLine::WATCH) ? 1 : 0);
+        edits += sign * ((line.flags & MinimapLine::EDITED) ? 1 : 0);
+    }
+
+    void add(const MinimapSummary& other, int sign) {
+        lines += sign * other.lines;
+        ink += sign * other.ink;
+        matches += sign * other.matches;
+        watches += sign * other.watches;
+        edits += sign * other.edits;
+    }
+};
+
+// Summaries of the document for the minimap strip. Lines are grouped into blocks of about
+// BLOCK_LINES, and a segment tree holds the sum of every block, so the lines covered by a strip
+// row are summed in O(log n + BLOCK_LINES) and a frame costs O(screen height) whatever the file
+// size. Editing a line updates one leaf and its ancestors in O(log n); inserted lines join the
+// block they land in, which is split (by regrouping every block) once it holds twice its share.
+// Once the strip has been drawn for a file, edited flags are kept up to date even while it is
+// hidden; everything else only while it is shown.
+class Minimap {
+    private:
+        static constexpr int BLOCK_LINES = 64;
+        std::vector<MinimapLine> perLine;
+        std::vector<MinimapSummary> tree;  // tree[1] is the root, leaves start at tree[leafBase]
+        int leafBase = 1;
+        int blockCount = 0;
+        bool current = false;              // Whether ink, matches and watches describe the document
+
+        void updateLeaf(int block, const MinimapLine& line, int sign) {
+            for (int node = leafBase + block; node >= 1; node /= 2) tree[node].add(line, sign);
         }
-        
-        // Draw the file browser interface
-        void drawFileBrowser() {
-            std::ostringstream buffer;
-            buffer.str(""); 
-            buffer.clear();
-            
-            // Title bar
-            std::string title = " File Browser: " + currentDirectory.string() + " ";
-            if (title.size() > static_cast<size_t>(screenCols)) {
-                // Truncate with ellipsis if too long
-                title = " File Browser: ..." + currentDirectory.string().substr(
-                    currentDirectory.string().size() - (screenCols - 20)) + " ";
-            }
-            std::string titleBar = title + std::string(screenCols - title.size(), ' ');
-            buffer << titleBar;
-            
-            // File/directory entries
-            std::vector<std::string> displayLines;
-            std::vector<WORD> attributes(screenCols * screenRows, FILE_COLOR);
-            
-            // Set title bar attributes (white on blue background)
-            for (int i = 0; i < screenCols; i++) {
-                attributes[i] = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
-            }
-            
-            // Add each visible entry
-            for (int i = 0; i < screenRows - 2; i++) {
-                int entryIndex = i + scrollOffset;
-                
-                if (entryIndex < static_cast<int>(entries.size())) {
-                    const fs::path& entry = entries[entryIndex];
-                    std::string filename;
-                    
-                    // Format parent directory specially
-                    if (entry == currentDirectory.parent_path()) {
-                        filename = "..";
-                    } else {
-                        filename = entry.filename().string();
-                    }
-                    
-                    // Indicate directories with a trailing slash
-                    if (fs::is_directory(entry)) {
-                        filename += "/";
-                    }
-                    
-                    // Truncate if too long for display
-                    if (filename.size() > static_cast<size_t>(screenCols - 4)) {
-                        filename = filename.substr(0, screenCols - 7) + "...";
-                    }
-                    
-                    // Format the display line with padding for selection cursor
-                    std::string displayLine = (entryIndex == selectedIndex ? "> " : "  ") + 
-                                            filename + 
-                                            std::string(screenCols - filename.size() - 2, ' ');
-                    
-                    buffer << displayLine;
-                    
-                    // Set attributes for this line
-                    int lineStart = (i + 1) * screenCols;
-                    WORD baseColor = fs::is_directory(entry) ? DIRECTORY_COLOR : FILE_COLOR;
-                    
-                    for (int j = 0; j < screenCols; j++) {
-                        attributes[lineStart + j] = (entryIndex == selectedIndex) ? SELECTED_COLOR : baseColor;
-                    }
+
+        // The block holding `line` and that block's first line, found by descending on line counts
+        std::pair<int, int> blockOf(int line) const {
+            int node = 1, first = 0;
+            while (node < leafBase) {
+                int left = node * 2;
+                if (line < first + tree[left].lines) {
+                    node = left;
                 } else {
-                    // Empty line
-                    buffer << std::string(screenCols, ' ');
+                    first += tree[left].lines;
+                    node = left + 1;
                 }
             }
-            
-            // Status bar / help line
-            std::string helpLine = " [↑/↓] Navigate  [Enter] Open/Enter  [Esc] Cancel ";
-            std::string statusBar = helpLine + std::string(screenCols - helpLine.size(), ' ');
-            buffer << statusBar;
-            
-            // Set status bar attributes (white on blue)
-            int statusStart = (screenRows - 1) * screenCols;
-            for (int i = 0; i < screenCols; i++) {
-                attributes[statusStart + i] = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | BACKGROUND_BLUE;
+            return { node - leafBase, first };
+        }
+
+        // Regroups the lines into blocks of BLOCK_LINES and builds the tree bottom-up: O(n)
+        void regroup() {
+            int lineCount = (int)perLine.size();
+            blockCount = std::max(1, (lineCount + BLOCK_LINES - 1) / BLOCK_LINES);
+            leafBase = 1;
+            while (leafBase < blockCount) leafBase *= 2;
+            tree.assign(leafBase * 2, MinimapSummary());
+            for (int i = 0; i < lineCount; ++i) tree[leafBase + i / BLOCK_LINES].add(perLine[i], 1);
+            for (int node = leafBase - 1; node >= 1; --node) {
+                tree[node] = tree[node * 2];
+                tree[node].add(tree[node * 2 + 1], 1);
             }
-            
-            // Get the entire buffer as a string
-            std::string output = buffer.str();
-            
-            // Write the buffer (text) to console
-            HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-            DWORD written;
-            WriteConsoleOutputCharacterA(hOut, output.c_str(), output.size(), {0, 0}, &written);
-            
-            // Write the attributes to the console
-            for (int y = 0; y < screenRows; y++) {
-                int startIdx = y * screenCols;
-                WriteConsoleOutputAttribute(hOut, &attributes[startIdx], screenCols, {0, (SHORT)y}, &written);
+        }
+
+    public:
+        bool isCurrent() const { return current; }
+
+        // The summaries must be recomputed before the next draw (new search, new watch list, shown again)
+        void invalidate() { current = false; }
+
+        // Recomputes every line with `summarize` (which fills in ink, match and watch), keeping edited flags
+        template <typename Summarize>
+        void refresh(int lineCount, Summarize summarize) {
+            perLine.resize(lineCount);
+            for (int i = 0; i < lineCount; ++i) {
+                uint8_t edited = perLine[i].flags & MinimapLine::EDITED;
+                perLine[i] = summarize(i);
+                perLine[i].flags |= edited;
             }
+            regroup();
+            current = true;
         }
-        
-        // Handle keyboard input and navigation
-        bool handleInput(int key) {
-            switch (key) {
-                case VK_UP:    // Up arrow
-                    if (selectedIndex > 0) {
-                        selectedIndex--;
-                        // Adjust scroll if necessary
-                        if (selectedIndex < scrollOffset) {
-                            scrollOffset = selectedIndex;
-                        }
-                    }
-                    return true;
-                    
-                case VK_DOWN:  // Down arrow
-                    if (selectedIndex < static_cast<int>(entries.size()) - 1) {
-                        selectedIndex++;
-                        // Adjust scroll if necessary
-                        if (selectedIndex >= scrollOffset + screenRows - 2) {
-                            scrollOffset = selectedIndex - (screenRows - 2) + 1;
-                        }
-                    }
-                    return true;
-                    
-                case VK_RETURN:  // Enter key
-                    if (selectedIndex >= 0 && selectedIndex < static_cast<int>(entries.size())) {
-                        const fs::path& selected = entries[selectedIndex];
-                        
-                        if (fs::is_directory(selected)) {
-                            // Enter directory
-                            currentDirectory = selected;
-                            selectedIndex = 0;
-                            scrollOffset = 0;
-                            refreshEntries();
-                            return true;
-                        } else {
-                            // Return the selected file path to be opened
-                            return false;  // Exit file browser mode
-                        }
-                    }
-                    return true;
-                    
-                case VK_ESCAPE:  // Escape key
-                    return false;  // Cancel and exit file browser mode
-                    
-                default:
-                    return true;  // Ignore other keys
+
+        // New document: nothing is edited and nothing is summarized yet
+        void reset() {
+            perLine.clear();
+            current = false;
+        }
+
+        void lineChanged(int row, MinimapLine line) {
+            if (row < 0 || row >= (int)perLine.size()) return;
+            line.flags |= MinimapLine::EDITED;
+            if (current) {
+                int block = blockOf(row).first;
+                updateLeaf(block, perLine[row], -1);
+                updateLeaf(block, line, 1);
+                perLine[row] = line;
+            } else {
+                perLine[row].flags |= MinimapLine::EDITED;
             }
         }
-        
-        // Get the currently selected file path (if a file is selected)
-        fs::path getSelectedFile() const {
-            if (selectedIndex >= 0 && selectedIndex < static_cast<int>(entries.size())) {
-                const fs::path& selected = entries[selectedIndex];
-                if (!fs::is_directory(selected)) {
-                    return selected;
+
+        // `lineAt(i)` summarizes the i-th inserted line (only called while the summaries are current)
+        template <typename LineAt>
+        void linesInserted(int row, int count, LineAt lineAt) {
+            if (row < 0 || row > (int)perLine.size() || count <= 0) return;
+            MinimapLine edited;
+            edited.flags = MinimapLine::EDITED;
+            perLine.insert(perLine.begin() + row, count, edited);
+            if (!current) return;
+
+            int block = blockOf(std::max(0, row - 1)).first;  // Lines appended at the end join the last block
+            for (int i = 0; i < count; ++i) {
+                MinimapLine line = lineAt(i);
+                line.flags |= MinimapLine::EDITED;
+                perLine[row + i] = line;
+                updateLeaf(block, line, 1);
+            }
+            if (tree[leafBase + block].lines > 2 * BLOCK_LINES) regroup();
+        }
+
+        void linesErased(int row, int count) {
+            if (row < 0 || count <= 0) return;
+            count = std::min(count, (int)perLine.size() - row);
+            if (count <= 0) return;
+            if (current) {
+                for (int i = row; i < row + count; ++i) updateLeaf(blockOf(i).first, perLine[i], -1);
+                if (blockCount > 4 * ((int)perLine.size() - count) / BLOCK_LINES + 4) {
+                    perLine.erase(perLine.begin() + row, perLine.begin() + row + count);
+                    regroup();  // Mostly empty blocks left behind
+                    return;
                 }
             }
-            return fs::path();  // Empty path if no file selected
+            perLine.erase(perLine.begin() + row, perLine.begin() + row + count);
         }
 
-        fs::path getCurrentDirectory() const {
-            return currentDirectory;
+        int lineCount() const { return (int)perLine.size(); }
+
+        // Sums over lines [0, line): whole blocks from the tree, the rest of the last block line by line
+        MinimapSummary prefix(int line) const {
+            MinimapSummary sum;
+            line = std::max(0, std::min(line, (int)perLine.size()));
+            if (line == 0) return sum;
+            int node = 1, first = 0;
+            while (node < leafBase) {
+                int left = node * 2;
+                if (line < first + tree[left].lines) {
+                    node = left;
+                } else {
+                    sum.add(tree[left], 1);
+                    first += tree[left].lines;
+                    node = left + 1;
+                }
+            }
+            for (int i = first; i < line; ++i) sum.add(perLine[i], 1);
+            return sum;
         }
 };
 
 class Nite {
     public:
-        std::unordered_map<std::string, std::string> cxxKeywords = {
-            // **Built-in Types**
-            {"bool", "Type"}, {"char", "Type"}, {"char8_t", "Type"}, {"char16_t", "Type"},
-            {"char32_t", "Type"}, {"double", "Type"}, {"float", "Type"}, {"int", "Type"},
-            {"long", "Type"}, {"short", "Type"}, {"signed", "Type"}, {"unsigned", "Type"},
-            {"void", "Type"}, {"wchar_t", "Type"},
-        
-            // **Type Modifiers / Qualifiers**
-            {"const", "Type Modifier"}, {"constexpr", "Type Modifier"}, {"consteval", "Type Modifier"},
-            {"constinit", "Type Modifier"}, {"inline", "Type Modifier"}, {"mutable", "Type Modifier"},
-            {"volatile", "Type Modifier"}, {"static", "Type Modifier"}, {"register", "Type Modifier"},
-            {"thread_local", "Type Modifier"},
-        
-            // **Type Casts**
-            {"const_cast", "Cast"}, {"dynamic_cast", "Cast"}, {"reinterpret_cast", "Cast"},
-            {"static_cast", "Cast"},
-        
-            // **Control Flow**
-            {"break", "Control Flow"}, {"case", "Control Flow"}, {"continue", "Control Flow"},
-            {"default", "Control Flow"}, {"do", "Control Flow"}, {"else", "Control Flow"},
-            {"for", "Control Flow"}, {"goto", "Control Flow"}, {"if", "Control Flow"},
-            {"return", "Control Flow"}, {"switch", "Control Flow"}, {"while", "Control Flow"},
-        
-            // **Logical / Bitwise Operators (Alternative Tokens and Keywords)**
-            {"and", "Operator"}, {"and_eq", "Operator"}, {"bitand", "Operator"}, {"bitor", "Operator"},
-            {"compl", "Operator"}, {"not", "Operator"}, {"not_eq", "Operator"}, {"or", "Operator"},
-            {"or_eq", "Operator"}, {"xor", "Operator"}, {"xor_eq", "Operator"},
-        
-            // **Symbolic Operators**
-            {"+", "Operator"}, {"-", "Operator"}, {"*", "Operator"}, {"/", "Operator"}, {"%", "Operator"},
-            {"++", "Operator"}, {"--", "Operator"}, // Arithmetic
-            {"==", "Operator"}, {"!=", "Operator"}, {"<", "Operator"}, {">", "Operator"},
-            {"<=", "Operator"}, {">=", "Operator"}, // Comparison
-            {"!", "Operator"}, {"&&", "Operator"}, {"||", "Operator"}, // Logical
-            {"&", "Operator"}, {"|", "Operator"}, {"^", "Operator"}, {"~", "Operator"}, // Bitwise
-            {"<<", "Operator"}, {">>", "Operator"}, // Bit shift
-            {"=", "Operator"}, {"+=", "Operator"}, {"-=", "Operator"}, {"*=", "Operator"}, {"/=", "Operator"},
-            {"%=", "Operator"}, {"&=", "Operator"}, {"|=", "Operator"}, {"^=", "Operator"},
-            {"<<=", "Operator"}, {">>=", "Operator"}, // Assignment
-            {"?", "Operator"}, {":", "Operator"}, // Ternary
-            {".", "Operator"}, {"->", "Operator"}, {"->*", "Operator"}, {".*", "Operator"}, // Member access
-            {",", "Operator"}, // Comma
-        
-            // **Memory Management**
-            {"new", "Memory Management"}, {"delete", "Memory Management"},
-            {"sizeof", "Memory Management"}, {"alignas", "Memory Management"},
-            {"alignof", "Memory Management"},
-        
-            // **Exception Handling**
-            {"try", "Exception Handling"}, {"catch", "Exception Handling"}, {"throw", "Exception Handling"},
-        
-            // **Object-Oriented Keywords**
-            {"struct", "Object-Oriented"}, {"enum", "Object-Oriented"}, {"class", "Object-Oriented"},
-            {"friend", "Object-Oriented"}, {"private", "Object-Oriented"}, {"protected", "Object-Oriented"},
-            {"public", "Object-Oriented"}, {"this", "Object-Oriented"}, {"virtual", "Object-Oriented"},
-        
-            // **Templates & Generics**
-            {"template", "Template"}, {"typename", "Template"}, {"using", "Template"},
-        
-            // **Namespace & Modules**
-            {"namespace", "Namespace"}, {"export", "Namespace"},
-        
-            // **Cast/Type-Introspection**
-            {"decltype", "Cast/Introspection"}, {"typeid", "Cast/Introspection"},
-        
-            // **Operator Overloading**
-            {"operator", "Operator Overloading"},
-        
-            // **Boolean Literals**
-            {"true", "Boolean Literal"}, {"false", "Boolean Literal"},
-        
-            // **Null / Undefined**
-            {"nullptr", "Null/Undefined"},
-        
-            // **Preprocessor**
-            {"define", "Preprocessor"}, {"include", "Preprocessor"}, {"undef", "Preprocessor"},
-            {"ifdef", "Preprocessor"}, {"ifndef", "Preprocessor"}, {"if", "Preprocessor"},
-            {"else", "Preprocessor"}, {"elif", "Preprocessor"}, {"endif", "Preprocessor"},
-            {"pragma", "Preprocessor"},
-        
-            // **Coroutines (C++20)**
-            {"co_await", "Coroutines"}, {"co_return", "Coroutines"}, {"co_yield", "Coroutines"},
-        
-            // **Concepts (C++20)**
-            {"concept", "Concepts"}, {"requires", "Concepts"},
-        
-            // **Miscellaneous**
-            {"asm", "Miscellaneous"}, {"explicit", "Miscellaneous"}, {"extern", "Miscellaneous"},
-            {"noexcept", "Miscellaneous"}, {"static_assert", "Miscellaneous"}
-        };
         int screenRows, screenCols;  // Dimensions of the editor's screen (number of rows and columns visible at a time)
         int cursorX = 0, cursorY = 0;  // Current cursor position (X for horizontal, Y for vertical)
         int rowOffset = 0, colOffset = 0;  // Offsets for scrolling the screen (how much of the file is scrolled)
+        int rowSegment = 0;                // With soft wrap: which wrapped row of line rowOffset is at the top
+        int drawnTopRow = -1;              // Document row at the top of the last editor frame, so a scroll can shift the screen instead of redrawing it
+        WrapLayout wrapLayout;             // Line breaks and row counts while soft wrap is on
+        Minimap minimap;                   // Block summaries behind the minimap strip
+        PerformanceGovernor governor;      // Cuts back detail when editor frames run over budget
+        std::string minimapQuery;          // Search the minimap's match marks were computed for
+        static constexpr int MINIMAP_COLUMNS = 2;  // Shading column and marker column
         bool dirty = false;  // Flag indicating if the file has unsaved changes
         std::string filename;  // The name of the file currently being edited
         std::vector<std::string> lines;  // A vector to store each line of the text file as a string
@@ -524,33 +4576,67 @@ class Nite {
         int lastSearchPos = -1;     // Position of the last search result
         int lastSearchLine = -1;    // Line number of the last search result
         bool searchActive = false;  // Flag to indicate if a search is currently active
+        MatchIndex matchIndex;      // Cached per-line hits of the search query, painted as an overlay
+        std::vector<std::pair<int, int>> watchSpans;  // Scratch spans of watch-term hits for the line being drawn
+        SyntaxCache syntaxCache;                      // Token colors and lexer states per line, relexed only after edits
+        StyleSpans lineStyle;                         // Styling of the line being drawn
+        std::vector<std::pair<int, int>> overlayRanges;  // Scratch column ranges for an overlay
+        std::mutex documentMutex;                     // Held by the editor thread except while it waits for keys
+        std::unique_lock<std::mutex> documentLock{ documentMutex, std::defer_lock };
+        HighlightWorker highlighter;                  // Fills syntaxCache on its own thread
+        int highlightFrom = 0, highlightTo = 0;       // Lines the last editor frame showed
+        bool visibleStale = false;                    // Some of them were drawn without current colors
+        bool surroundingsDone = true;                 // Lines around them are lexed for the current view and text
     
         // SB (Status Bar) helper variables
         bool waitingForInput = false;  // Flag to indicate if the editor is waiting for user input (e.g., in a command mode)
         std::string statusPrompt = ""; // A string to store the prompt displayed in the status bar
         std::string statusInput = "";  // A string to store the user's input in the status bar
         bool processingInput = false;  // Flag to indicate if the editor is currently processing user input
-        enum InputType { NONE, OPEN_FILE, GOTO_LINE };  // Enum for different types of user input (None, opening a file, or going to a specific line)
+        enum InputType { NONE, OPEN_FILE, GOTO_LINE, SEARCH_FILE, REPLACE_FILE_FIND, REPLACE_FILE_WITH,
+                         SEARCH_DIRECTORY, REPLACE_DIRECTORY_FIND, REPLACE_DIRECTORY_WITH };  // Enum for different types of user input (None, opening a file, going to a specific line, or searching/replacing in the file or a directory)
         InputType currentInputType = NONE;  // The current type of input being processed (initialized to NONE)
+        std::string statusMessage = "";     // One-off message (e.g. a replace count) shown in the status bar until the next key
+        std::string statusLine;             // Scratch space the status bar is built in each frame
+#ifdef NITE_DEBUG_ALLOCS
+        size_t framesDrawn = 0;             // Frames rendered so far
+        size_t framesAllocating = 0;        // Editor/browser frames that touched the heap
+#endif
+
+        // Input coalescing: keys that are already queued are all applied before the next frame,
+        // but while input keeps arriving a frame is still drawn at least this often
+        static constexpr std::chrono::milliseconds FRAME_INTERVAL{16};
 
         // File browser mode
         bool inFileBrowserMode = false;
         std::unique_ptr<FileNavigator> fileNavigator;  // Pointer to a FileNavigator object for file browsing functionality
 
+        // Directory search / replace mode
+        bool inSearchResultsMode = false;
+        bool showingReplacePreview = false;                      // Whether the results list shows projectReplace instead of projectSearch
+        std::unique_ptr<ProjectSearch> projectSearch;            // The running (or last finished) directory search
+        std::unique_ptr<ProjectReplace> projectReplace;          // The pending (or last applied) directory replace
+        std::string pendingDirectoryFind;                        // Text to replace, kept while prompting for its replacement
+        std::unique_ptr<SearchResultsView> searchResultsView;    // The results list drawn while in search results mode
+        fs::path searchRoot;                                     // Directory the next directory search starts from
+        bool searchResultsFinalShown = false;                    // Whether the finished search has been painted once
+
+        // Fuzzy file finder (Ctrl+P)
+        bool inFuzzyFinderMode = false;
+        bool persistPathIndex = true;              // Whether the path index is kept in the user's cache directory between sessions
+        std::unique_ptr<FuzzyFinder> fuzzyFinder;  // Owns the project path index; created on the first Ctrl+P
+
         // File state variables
         std::string currentFile = "";  // Current file path
         bool isModified = false;       // Track if file has unsaved changes
+#ifndef _WIN32
+        std::string clipboard;         // Copied text (POSIX terminals have no clipboard API to call)
+#endif
 
         Nite() {
             loadColorConfig(getNiteConfigPath());  // Load color configuration from the .niteconfig file located in the executable directory.
 
             getWindowSize(screenRows, screenCols);  // Calls the function getWindowSize to initialize screenRows and screenCols with the current window size.
-            
-            HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);  // Gets the handle for the standard output (console window) to manipulate its properties.
-            
-            COORD newSize = { static_cast<SHORT>(screenCols), static_cast<SHORT>(screenRows) };  // Creates a COORD structure to define the new size of the console window, using the previously obtained screen dimensions.
-            
-            SetConsoleScreenBufferSize(hOut, newSize);  // Sets the screen buffer size of the console window to match the specified dimensions (screenCols, screenRows).
         }
 
         void enterFileBrowserMode(const std::string& initialPath = "") {
@@ -567,8 +4653,13 @@ class Nite {
         }
 
         std::string getExecutableDir() {
+#ifdef _WIN32
             char path[MAX_PATH];
             GetModuleFileNameA(NULL, path, MAX_PATH);
+#else
+            char path[4096] = {};
+            if (readlink("/proc/self/exe", path, sizeof(path) - 1) < 0) return "";
+#endif
         
             std::string fullPath(path);
             size_t lastSlash = fullPath.find_last_of("\\/");
@@ -583,56 +4674,66 @@ class Nite {
         }
 
         void getWindowSize(int &rows, int &cols) {
-            CONSOLE_SCREEN_BUFFER_INFO csbi;  // Declare a variable of type CONSOLE_SCREEN_BUFFER_INFO to store console screen buffer information.
-            
-            // Calls GetConsoleScreenBufferInfo to retrieve information about the current console screen buffer and stores it in 'csbi'.
-            GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
-            
-            // Calculates the number of columns by subtracting the left edge from the right edge of the console window.
-            cols = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-            
-            // Calculates the number of rows by subtracting the top edge from the bottom edge of the console window.
-            rows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-        }        
+            terminal->getSize(rows, cols);  // Asks the terminal backend for the visible window size in rows and columns.
+        }
 
-        void moveCursor(int row, int col) {
-            COORD coord = { static_cast<SHORT>(col), static_cast<SHORT>(row) };  // Creates a COORD structure to store the new cursor position (column and row).
-            
-            // Calls SetConsoleCursorPosition to move the console's cursor to the specified position (row, col).
-            SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
+        // Takes the terminal's current size. The views lay themselves out again; soft-wrap breaks
+        // follow lazily from the new width. The terminal may have reflowed or cleared the old
+        // contents, so the next frame repaints every cell.
+        void applyWindowSize() {
+            getWindowSize(screenRows, screenCols);
+            if (fileNavigator) fileNavigator->resize(screenRows, screenCols);
+            if (searchResultsView) searchResultsView->resize(screenRows, screenCols);
+            if (fuzzyFinder && inFuzzyFinderMode) fuzzyFinder->resize(screenRows, screenCols);
+            screen.invalidate();
         }        
 
-        void drawStatusBar(std::ostringstream &sb) {
-            if (waitingForInput) {  // Checks if the editor is waiting for user input (e.g., during a prompt).
+        void drawStatusBar() {
+            const WORD STATUS_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+            int row = screenRows - 1;  // The status bar is the bottom row of the screen
+            std::string& status = statusLine;  // Reused every frame, so building the bar does not allocate
+            status.clear();
+
+            if (!statusMessage.empty() && !waitingForInput) {  // A one-off message replaces the status until the next key.
+                status += statusMessage;
+            } else if (waitingForInput) {  // Checks if the editor is waiting for user input (e.g., during a prompt).
                 // Show prompt and current input
-                std::string status = statusPrompt + statusInput;  // Combines the status prompt with the current user input.
-                
-                // If the status string is shorter than the screen width, pad it with spaces. Otherwise, truncate it.
-                if ((int)status.size() < screenCols)
-                    sb << status << std::string(screenCols - status.size(), ' ');
-                else
-                    sb << status.substr(0, screenCols);  // Truncate the status to fit within the screen width.
+                status += statusPrompt;
+                status += statusInput;
             } else {  // If not waiting for input, draw the normal status bar.
                 // Build the status string with general information (e.g., editor name, filename, modifications, selection state).
-                std::string status = "[Nite_V1] " + (filename.empty() ? "[No Name]" : filename);  // Shows editor name or file name if available.
+                status += "[Nite_V1] ";
+                if (filename.empty()) status += "[No Name]";  // Shows editor name or file name if available.
+                else status += filename;
                 
                 if (dirty) status += " (modified)";  // Indicates if the file has unsaved changes.
+                if (governor.isReducing()) status += " (reduced detail)";  // The governor is keeping frames fast.
                 if (hasSelection) status += " (text selected)";  // Indicates if there is a text selection.
         
-                // Adds the cursor position (row and column) to the status.
-                status += " | Row: " + std::to_string(cursorY + 1) + " | Col: " + std::to_string(cursorX + 1);  // Converts to 1-based indexing.
+                // Adds the cursor position (row and column) to the status, converted to 1-based indexing.
+                status += " | Row: ";
+                appendDecimal(status, cursorY + 1);
+                status += " | Col: ";
+                appendDecimal(status, cursorX + 1);
         
                 // If search is active, include search query details in the status.
                 if (searchActive) {
-                    status += " | Searching: \"" + searchQuery + "\"";  // Shows the current search query.
+                    status += " | Searching: \"";  // Shows the current search query.
+                    status += searchQuery;
+                    status += "\" (";
+                    matchIndex.setQuery(searchQuery);
+                    auto countStart = PerformanceGovernor::Clock::now();
+                    int limit = governor.matchCountLimit();
+                    bool complete = true;
+                    int count = limit < 0 ? matchIndex.countAll(lines) : matchIndex.countSome(lines, limit, complete);
+                    governor.charge(PerformanceGovernor::MATCH_COUNT, countStart);
+                    appendDecimal(status, count);  // Shows how many hits the document has (so far, while cut back).
+                    status += complete ? " matches)" : "+ matches)";
                 }
-                
-                // If the status string is shorter than the screen width, pad it with spaces. Otherwise, truncate it.
-                if ((int)status.size() < screenCols)
-                    sb << status << std::string(screenCols - status.size(), ' ');
-                else
-                    sb << status.substr(0, screenCols);  // Truncate the status to fit within the screen width.
             }
+
+            // The rest of the row is already blank; text() truncates the status to fit within the screen width.
+            screen.text(row, 0, status, STATUS_COLOR);
         }        
     
         void startStatusInput(const std::string &prompt, InputType type) {
@@ -644,6 +4745,9 @@ class Nite {
         }
     
         void processStatusInput() {
+            std::string followUpPrompt;     // Some prompts chain into a second one (find, then replace with)
+            InputType followUpType = NONE;
+
             switch (currentInputType) {  // Switch on the type of input that the editor is currently processing.
                 case OPEN_FILE:  // If the input type is OPEN_FILE, process the file open command.
                     if (!statusInput.empty()) {  // Check if the user has entered any input.
@@ -661,6 +4765,38 @@ class Nite {
                         }
                     }
                     break;
+                case SEARCH_FILE:  // If the input type is SEARCH_FILE, jump to the first match of the query.
+                case REPLACE_FILE_FIND:  // A replace without a query searches first, then asks for the replacement.
+                    if (!statusInput.empty()) {
+                        searchQuery = statusInput;  // Set the search query
+                        searchActive = true;        // Mark the search as active
+                        lastSearchLine = -1;        // Reset the last search line position
+                        lastSearchPos = -1;         // Reset the last search position
+                        findNext();                 // Perform the actual search
+                        if (currentInputType == REPLACE_FILE_FIND) {
+                            followUpPrompt = "Replace all with: ";
+                            followUpType = REPLACE_FILE_WITH;
+                        }
+                    }
+                    break;
+                case REPLACE_FILE_WITH:  // The replacement may be empty (deletes every match).
+                    replaceAllWith(statusInput);
+                    break;
+                case SEARCH_DIRECTORY:  // If the input type is SEARCH_DIRECTORY, grep the chosen directory.
+                    if (!statusInput.empty()) {
+                        startProjectSearch(searchRoot, statusInput);
+                    }
+                    break;
+                case REPLACE_DIRECTORY_FIND:  // First half of a directory replace: remember what to replace.
+                    pendingDirectoryFind = statusInput;
+                    if (!pendingDirectoryFind.empty()) {
+                        followUpPrompt = "Replace \"" + pendingDirectoryFind + "\" with: ";
+                        followUpType = REPLACE_DIRECTORY_WITH;
+                    }
+                    break;
+                case REPLACE_DIRECTORY_WITH:  // Second half: the replacement may be empty (deletes the text).
+                    startProjectReplace(searchRoot, pendingDirectoryFind, statusInput);
+                    break;
                 default:
                     break;  // If no valid input type, do nothing.
             }
@@ -671,6 +4807,11 @@ class Nite {
             statusInput = "";          // Clear the input entered by the user.
             currentInputType = NONE;   // Reset the input type to NONE.
             processingInput = false;   // Indicate that input processing is finished.
+
+            // A replace asks for its replacement text as a second prompt
+            if (followUpType != NONE) {
+                startStatusInput(followUpPrompt, followUpType);
+            }
         }
 
         bool isPositionSelected(int fileRow, int fileCol) {
@@ -720,260 +4861,637 @@ class Nite {
             }
         }
 
+        // === Line change notifications ===
+        // Every edit that touches `lines` reports the affected rows so per-line caches only
+        // redo the work for what actually changed.
+        void lineChanged(int row) {
+            matchIndex.lineChanged(row);
+            syntaxCache.lineChanged(row);
+            surroundingsDone = false;
+            wrapLayout.lineChanged(lines, row);
+            minimap.lineChanged(row, minimap.isCurrent() ? summarizeLine(row) : MinimapLine());
+        }
+
+        void linesInserted(int row, int count) {
+            matchIndex.linesInserted(row, count);
+            syntaxCache.linesInserted(row, count);
+            surroundingsDone = false;
+            wrapLayout.linesInserted(lines, row, count);
+            minimap.linesInserted(row, count, [this, row](int i) { return summarizeLine(row + i); });
+        }
+
+        void linesErased(int row, int count) {
+            matchIndex.linesErased(row, count);
+            syntaxCache.linesErased(row, count);
+            surroundingsDone = false;
+            wrapLayout.linesErased(row, count);
+            minimap.linesErased(row, count);
+        }
+
+        void linesReset() {
+            matchIndex.reset();
+            syntaxCache.reset();
+            surroundingsDone = false;
+            wrapLayout.reset();
+            minimap.reset();
+        }
+
+        // What the minimap shows for one line: its amount of text, and whether it has a hit of the
+        // search the minimap was last drawn for or a watch-list term
+        MinimapLine summarizeLine(int row) {
+            const std::string& line = lines[row];
+            MinimapLine summary;
+            int ink = 0;
+            for (char c : line) ink += c != ' ' && c != '\t';
+            summary.ink = (uint16_t)std::min(ink, 0xFFFF);
+            if (!minimapQuery.empty() && !matchIndex.lineMatches(lines, row).empty()) summary.flags |= MinimapLine::MATCH;
+            if (!watchAutomaton.empty()) {
+                watchSpans.clear();
+                watchAutomaton.findSpans(line, 0, (int)line.size(), watchSpans);
+                if (!watchSpans.empty()) summary.flags |= MinimapLine::WATCH;
+            }
+            return summary;
+        }
+
+        int minimapColumns() const { return showMinimap ? MINIMAP_COLUMNS : 0; }
+
+        // The overview strip along the right edge. Each row stands for an equal slice of the file,
+        // shaded by the average amount of text per line and marked where the slice has search hits
+        // (=), watch terms (!) or edits (+). Rows over the lines in [visibleFrom, visibleTo) are lit.
+        void drawMinimap(int visibleFrom, int visibleTo) {
+            static const std::string noQuery;
+            const std::string& activeQuery = searchActive ? searchQuery : noQuery;
+            if (!minimap.isCurrent() || minimapQuery != activeQuery || minimap.lineCount() != (int)lines.size()) {
+                minimapQuery = activeQuery;
+                minimap.refresh((int)lines.size(), [this](int row) { return summarizeLine(row); });
+            }
+
+            const char* SHADES = " .:-=+*#";
+            const WORD INK_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+            const WORD EDIT_COLOR = FOREGROUND_GREEN | FOREGROUND_INTENSITY;
+            const WORD VIEW_BACKGROUND = BACKGROUND_INTENSITY;
+            int textRows = screenRows - 1;
+            int total = (int)lines.size();
+            int x = screenCols - MINIMAP_COLUMNS;
+            long long textWidth = std::max(1, screenCols - gutterColumns() - MINIMAP_COLUMNS);
+
+            MinimapSummary before;  // Sums over the lines above the current row's slice
+            for (int y = 0; y < textRows; ++y) {
+                int from = y, to = std::min(y + 1, total);  // A short file gets a row per line
+                if (total > textRows) {
+                    from = (int)((long long)y * total / textRows);
+                    to = (int)((long long)(y + 1) * total / textRows);
+                }
+                WORD background = (from < to && from < visibleTo && to > visibleFrom) ? VIEW_BACKGROUND : 0;
+                if (from >= to) {
+                    screen.fillAttr(y, x, MINIMAP_COLUMNS, background | INK_COLOR);
+                    continue;
+                }
+
+                MinimapSummary slice = minimap.prefix(to);
+                MinimapSummary upTo = slice;
+                slice.add(before, -1);
+                before = upTo;
+
+                long long average = slice.ink / slice.lines;
+                char shade = SHADES[average == 0 ? 0 : 1 + std::min(6LL, average * 7 / textWidth)];
+                char mark = ' ';
+                WORD markColor = background | INK_COLOR;
+                if (slice.matches > 0) {
+                    mark = '=';
+                    markColor = overlayColor(markColor, MATCH_COLOR);
+                } else if (slice.watches > 0) {
+                    mark = '!';
+                    markColor = overlayColor(markColor, WATCH_COLOR);
+                } else if (slice.edits > 0) {
+                    mark = '+';
+                    markColor = background | EDIT_COLOR;
+                }
+                screen.text(y, x, std::string_view(&shade, 1), background | INK_COLOR);
+                screen.text(y, x + 1, std::string_view(&mark, 1), markColor);
+            }
+        }
+
+        // Width of the line number gutter plus its " | " separator
+        int gutterColumns() const {
+            char digits[20];
+            return formatDecimal(std::max<size_t>(1, lines.size()), digits) + 3;
+        }
+
+        // Brings the wrap layout up to date with the document and the window width
+        void syncWrapLayout() {
+            wrapLayout.sync(lines, screenCols - gutterColumns() - minimapColumns());
+            if (rowOffset >= (int)lines.size()) rowOffset = std::max(0, (int)lines.size() - 1);
+            if (!lines.empty()) {
+                wrapLayout.layout(lines, rowOffset);
+                rowSegment = std::min(rowSegment, wrapLayout.rowsOf(rowOffset) - 1);
+            }
+        }
+
+        // Moves the cursor `rows` wrapped rows up (negative) or down, keeping its column within the row
+        void moveCursorRows(int rows) {
+            if (lines.empty()) return;
+            syncWrapLayout();
+            int segment = wrapLayout.segmentOf(lines, cursorY, cursorX);
+            int column = cursorX - wrapLayout.segmentStart(lines, cursorY, segment);
+            int target = std::max(0, std::min(wrapLayout.totalRows() - 1, wrapLayout.rowOf(cursorY) + segment + rows));
+
+            auto [line, targetSegment] = wrapLayout.lineAtRow(target);
+            wrapLayout.layout(lines, line);  // Its row count may have been an estimate
+            targetSegment = std::min(targetSegment, wrapLayout.rowsOf(line) - 1);
+            int start = wrapLayout.segmentStart(lines, line, targetSegment);
+            int end = wrapLayout.segmentEnd(lines, line, targetSegment);
+            bool lastSegment = targetSegment == wrapLayout.rowsOf(line) - 1;
+            cursorY = line;
+            cursorX = std::min(start + column, lastSegment ? end : std::max(start, end - 1));  // A break column belongs to the next row
+        }
+
+        // Lexes one whole line starting in `state` and leaves the state at its end there. Token
+        // colors are appended to `out` (left to right) unless it is null, which is how the states
+        // of lines off screen are caught up. Block comments and raw strings run on over lines;
+        // line comments, strings and directives do when the line ends in a backslash.
+        void lexLine(const std::string& line, LexState& state, std::vector<StyleSpan>* out) {
+            int lineEnd = (int)line.size();
+            auto emit = [out](int from, int to, WORD attr) {
+                if (!out || from >= to) return;
+                if (!out->empty() && out->back().to == from && out->back().attr == attr) {
+                    out->back().to = to;
+                } else {
+                    out->push_back({ from, to, attr });
+                }
+            };
+            int x = 0;
+
+            // Runs of identifier characters, and the next character worth a look, are found with bit
+            // scans over the classified line instead of testing one character at a time
+            CharClassScanner scan;
+            scan.reset(line.data(), lineEnd);
+            auto notIdentifier = [](const CharClassMasks& masks) { return ~masks.identifier; };
+
+            // A '#' first on a line starts a directive (on a continued one it is the stringizing operator)
+            if (state.mode == LexState::CODE && !state.directive) {
+                int first = scan.find(0, [](const CharClassMasks& masks) { return ~masks.space; });
+                if (first < lineEnd && line[first] == '#') {
+                    state.directive = true;
+                    x = scan.find(first + 1, [](const CharClassMasks& masks) { return ~masks.space; });
+                    x = scan.find(x, notIdentifier);
+                    emit(first, x, PREPROCESSOR_COLOR);
+                }
+            }
+
+            while (x < lineEnd) {
+                int start = x;
+
+                // Inside a block comment: up to and including the closing */
+                if (state.mode == LexState::BLOCK_COMMENT) {
+                    size_t close = line.find("*/", x);
+                    x = close == std::string::npos ? lineEnd : (int)close + 2;
+                    if (close != std::string::npos) state.mode = LexState::CODE;
+                    emit(start, x, MISC_COLOR);
+                    continue;
+                }
+
+                // Inside a line comment: the rest of the line
+                if (state.mode == LexState::LINE_COMMENT) {
+                    emit(start, lineEnd, MISC_COLOR);
+                    x = lineEnd;
+                    continue;
+                }
+
+                // Inside a string or character literal: up to the closing quote, stepping over escapes
+                if (state.mode == LexState::STRING || state.mode == LexState::CHAR_LITERAL) {
+                    char quote = state.mode == LexState::STRING ? '"' : '\'';
+                    x = scan.find(x, [](const CharClassMasks& masks) { return masks.quote | masks.backslash; });
+                    while (x < lineEnd && line[x] != quote) {
+                        x = line[x] == '\\' ? x + 2 : x + 1;
+                        x = scan.find(x, [](const CharClassMasks& masks) { return masks.quote | masks.backslash; });
+                    }
+                    if (x < lineEnd) {
+                        ++x;
+                        state.mode = LexState::CODE;
+                    }
+                    x = std::min(x, lineEnd);
+                    emit(start, x, TYPE_COLOR);
+                    continue;
+                }
+
+                // Inside a raw string: up to )delimiter"
+                if (state.mode == LexState::RAW_STRING) {
+                    std::string_view delimiter(state.delimiter, state.delimiterLength);
+                    x = lineEnd;
+                    for (size_t close = line.find(')', start); close != std::string::npos; close = line.find(')', close + 1)) {
+                        size_t quote = close + 1 + delimiter.size();
+                        if (quote < line.size() && line[quote] == '"' && line.compare(close + 1, delimiter.size(), delimiter) == 0) {
+                            x = (int)quote + 1;
+                            state.mode = LexState::CODE;
+                            break;
+                        }
+                    }
+                    emit(start, x, TYPE_COLOR);
+                    continue;
+                }
+
+                // Comments and literals open here; the branches above color them
+                if (line[x] == '/' && x + 1 < lineEnd && (line[x + 1] == '/' || line[x + 1] == '*')) {
+                    state.mode = line[x + 1] == '/' ? LexState::LINE_COMMENT : LexState::BLOCK_COMMENT;
+                    x += 2;
+                    emit(start, x, MISC_COLOR);
+                    continue;
+                }
+                if (line[x] == '"' || line[x] == '\'') {
+                    state.mode = line[x] == '"' ? LexState::STRING : LexState::CHAR_LITERAL;
+                    ++x;
+                    emit(start, x, TYPE_COLOR);
+                    continue;
+                }
+
+                // Numbers, including digit separators (1'000) and exponents (1e-5), are skipped whole
+                if ((charClass(line[x]) & CHAR_DIGIT) || (line[x] == '.' && x + 1 < lineEnd && (charClass(line[x + 1]) & CHAR_DIGIT))) {
+                    ++x;
+                    while (x < lineEnd) {
+                        char c = line[x];
+                        if ((c == '+' || c == '-') && std::strchr("eEpP", line[x - 1])) ++x;
+                        else if ((charClass(c) & CHAR_IDENTIFIER) || c == '.' || (c == '\'' && x + 1 < lineEnd && line[x + 1] != '_' && (charClass(line[x + 1]) & CHAR_IDENTIFIER))) ++x;
+                        else break;
+                    }
+                    continue;
+                }
+
+                // Without spans to fill, only identifiers (a raw string prefix) can still change the state:
+                // skip to the next one, or to where a comment or literal might open
+                if (!out && !startsIdentifier(line[x])) {
+                    x = scan.find(x + 1, [](const CharClassMasks& masks) { return masks.identifier | masks.quote | masks.slash; });
+                    continue;
+                }
+
+                // Handle angle-bracketed content (as long as no comment or literal opens inside it)
+                if (line[x] == '<') {
+                    int endPos = line.find('>', x + 1);
+                    if (static_cast<std::size_t>(endPos) != std::string::npos
+                        && line.find_first_of("\"'/", x + 1) > static_cast<std::size_t>(endPos)) {
+                        emit(start, endPos + 1, FOREGROUND_RED | FOREGROUND_INTENSITY);
+                        x = endPos + 1;
+                        continue;
+                    }
+                }
+
+                // Handle std::
+                if (line[x] == 's' && line.compare(x, 5, "std::") == 0) {
+                    emit(x, x + 5, FOREGROUND_RED);
+                    x += 5;
+                    continue;
+                }
+
+                // Handle identifiers and keywords
+                if (startsIdentifier(line[x])) {
+                    x = scan.find(x + 1, notIdentifier);
+                    std::string_view word(line.data() + start, x - start);
+
+                    // A raw string literal: R"delimiter(...)delimiter", possibly with an encoding prefix
+                    if (x < lineEnd && line[x] == '"' && (word == "R" || word == "LR" || word == "uR" || word == "UR" || word == "u8R")) {
+                        size_t open = line.find('(', x + 1);
+                        int delimiterLength = open == std::string::npos ? -1 : (int)open - x - 1;
+                        if (delimiterLength >= 0 && delimiterLength <= (int)sizeof(state.delimiter)
+                            && line.find_first_of(" \t\\)\"", x + 1) >= open) {
+                            state.mode = LexState::RAW_STRING;
+                            state.delimiterLength = (uint8_t)delimiterLength;
+                            std::memcpy(state.delimiter, line.data() + x + 1, delimiterLength);
+                            x = (int)open + 1;
+                            emit(start, x, TYPE_COLOR);
+                            continue;
+                        }
+                    }
+
+                    if (!out) continue;  // Keywords only matter for their colors
+
+                    // Handle std::
+                    if (word == "std" && x < lineEnd && line[x] == ':') {
+                        emit(start, start + 1, FOREGROUND_RED);
+                        continue;
+                    }
+
+                    KeywordCategory category = keywordCategory(word);
+                    if (category != KeywordCategory::NONE) emit(start, x, keywordColor(category));
+                    continue;
+                }
+
+                // Handle operators
+                int opLength = operatorLength(line.data() + x, line.data() + lineEnd);
+                if (opLength > 0) {
+                    emit(x, x + opLength, OPERATOR_COLOR);
+                    x += opLength;
+                } else {
+                    // Nothing here is colored: skip spaces and punctuation up to the next token
+                    x = scan.find(x + 1, [](const CharClassMasks& masks) { return masks.identifier | masks.quote | masks.operators; });
+                }
+            }
+
+            // Without a backslash at the end, line comments, unterminated literals and directives stop here
+            if (lineEnd == 0 || line[lineEnd - 1] != '\\') {
+                if (state.mode == LexState::LINE_COMMENT || state.mode == LexState::STRING || state.mode == LexState::CHAR_LITERAL) {
+                    state.mode = LexState::CODE;
+                }
+                state.directive = false;
+            }
+        }
+
+        // lexLine() in the form SyntaxCache takes it
+        auto lineLexer() {
+            return [this](const std::string& text, LexState& state, std::vector<StyleSpan>* out) { lexLine(text, state, out); };
+        }
+
+        // Whether the highlighter has anything left to do for the current view and text
+        bool highlightWorkLeft() const {
+            return syntaxHighlighting && (visibleStale || !surroundingsDone || syntaxCache.hasBackgroundWork((int)lines.size()));
+        }
+
+        // One slice of background highlighting, run by the highlighter with the document locked:
+        // the lines the last frame showed, then up to a screen's worth above and below them, then
+        // checkpoints for the rest of the file
+        HighlightWorker::Progress highlightSlice(HighlightWorker::Clock::time_point deadline) {
+            bool delivered = false;
+            if (syntaxHighlighting && (visibleStale || !surroundingsDone)) {
+                auto lex = lineLexer();
+                int from = std::min(highlightFrom, (int)lines.size());
+                int to = std::min(highlightTo, (int)lines.size());
+                int margin = std::clamp((SyntaxCache::KEPT_LINES - (to - from)) / 2, 0, to - from);
+                syntaxCache.keep(from - margin, to + margin);
+
+                // The visible lines start from the checkpoint above them, which may still have to be laid down
+                syntaxCache.fillSome(lines, lex, deadline, from);
+                if (!syntaxCache.reaches(from)) return { false, true };
+                for (int row = from; row < to; ++row) syntaxCache.lineSpans(lines, row, lex);
+                delivered = visibleStale;
+                visibleStale = false;
+
+                // Then the lines a short scroll away, nearest first below and in order above
+                int below = to, last = std::min((int)lines.size(), to + margin);
+                for (; below < last && HighlightWorker::Clock::now() < deadline; ++below) syntaxCache.lineSpans(lines, below, lex);
+                int above = std::max(0, from - margin);
+                for (; above < from && HighlightWorker::Clock::now() < deadline; ++above) syntaxCache.lineSpans(lines, above, lex);
+                surroundingsDone = below == last && above == from;
+            }
+            if (syntaxHighlighting) syntaxCache.fillSome(lines, lineLexer(), deadline);
+            return { delivered, highlightWorkLeft() };
+        }
+
+        // For --bench: how fast the whole document lexes, tracking states only (as checkpoints are
+        // laid down) and producing spans (as lines are drawn)
+        void writeLexStats(std::ostream& os) {
+            size_t bytes = 0;
+            for (const std::string& line : lines) bytes += line.size() + 1;
+            std::vector<StyleSpan> spans;
+            auto megabytesPerSecond = [&](bool withSpans) {
+                LexState state;
+                auto start = std::chrono::steady_clock::now();
+                for (const std::string& line : lines) {
+                    spans.clear();
+                    lexLine(line, state, withSpans ? &spans : nullptr);
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                return bytes / 1e6 / std::max(seconds, 1e-9);
+            };
+            double states = megabytesPerSecond(false);
+            double withSpans = megabytesPerSecond(true);
+            os << std::fixed;
+            os.precision(1);
+            os << "Lexing (MB/s): " << states << " states only, " << withSpans << " with spans ("
+#ifdef NITE_SSE2
+               << "SSE2"
+#else
+               << "scalar"
+#endif
+               << " character classes)\n";
+        }
+
+        // Finds the bracket that pairs with the one under the cursor. Only the visible rows are
+        // searched, since a partner off screen would not be drawn anyway.
+        bool findMatchingBracket(int& matchRow, int& matchCol) const {
+            static const char brackets[] = "()[]{}";
+            if (cursorY >= (int)lines.size() || cursorX >= (int)lines[cursorY].size()) return false;
+            char bracket = lines[cursorY][cursorX];
+            const char* found = bracket ? std::strchr(brackets, bracket) : nullptr;
+            if (!found) return false;
+
+            int index = (int)(found - brackets);
+            char partner = brackets[index ^ 1];
+            int step = (index & 1) ? -1 : 1;  // Closing brackets look backwards
+            int firstRow = rowOffset;
+            int lastRow = std::min((int)lines.size(), rowOffset + screenRows - 1) - 1;
+            int depth = 0;
+            for (int y = cursorY, x = cursorX; y >= firstRow && y <= lastRow; y += step) {
+                const std::string& line = lines[y];
+                if (y != cursorY) x = step > 0 ? 0 : (int)line.size() - 1;
+                for (; x >= 0 && x < (int)line.size(); x += step) {
+                    if (line[x] == bracket) ++depth;
+                    else if (line[x] == partner && --depth == 0) {
+                        matchRow = y;
+                        matchCol = x;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
         void drawEditor() {
-            std::ostringstream buffer;
-            buffer.str(""); buffer.clear();  // Clear and reset the output buffer to start fresh
+            screen.beginFrame(screenRows, screenCols);  // Start a fresh frame in the back grid
+            if (softWrap) {
+                syncWrapLayout();
+                colOffset = 0;
+            }
+            int topRow = softWrap ? wrapLayout.rowOf(rowOffset) + rowSegment : rowOffset;
+            if (drawnTopRow >= 0 && drawnTopRow != topRow) {
+                screen.hintScroll(0, screenRows - 1, topRow - drawnTopRow);  // Text rows only; the status bar stays put
+            }
+            governor.beginFrame(drawnTopRow != topRow);
+            drawnTopRow = topRow;
         
             // Normalized selection coordinates if a selection exists
             int startX = 0, startY = 0, endX = 0, endY = 0;
             if (hasSelection) {
                 normalizeSelection(startX, startY, endX, endY);  // Normalize the selection to ensure start is before end
             }
+
+            // The bracket under the cursor and its partner, if both are on screen
+            int bracketRow = -1, bracketCol = -1;
+            bool bracketMatched = findMatchingBracket(bracketRow, bracketCol);
+
+            if (searchActive && !searchQuery.empty()) {
+                matchIndex.setQuery(searchQuery);
+            }
         
-            // Handle line drawing with selection highlight using ANSI escape codes
+            // Gutter width only depends on the line count, so it is worked out once per frame
+            const WORD TEXT_COLOR = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;  // Normal colors
+            WORD baseColor = syntaxHighlighting ? TEXT_COLOR : DEFAULT_COLOR;     // Color of text no span covers
+            char lineNumber[20];
+            int lineNumberWidth = formatDecimal(std::max<size_t>(1, lines.size()), lineNumber);  // Width of line number gutter
+            int gutterWidth = lineNumberWidth + 3;  // 3 for the separator " | "
+
+            int wrapLine = rowOffset, wrapSegment = rowSegment;  // Soft wrap: the line and wrapped row drawn next
+            int shownTo = rowOffset;  // One past the last line drawn, for the highlighter
+            visibleStale = false;
+
             for (int y = 0; y < screenRows - 1; ++y) {  // Loop through each screen row, leaving space for the status bar
-                int fileRow = y + rowOffset;  // Map screen row to file row, offset by rowOffset
-                std::string lineNumberPart;
-        
-                // Check if the file has a line for the current row
-                if (fileRow < (int)lines.size()) {
-                    lineNumberPart = std::to_string(fileRow + 1);  // Line number (1-based index)
-                } else {
-                    lineNumberPart = "~";  // Empty line indicated by a tilde
-                }
-        
-                // Pad line number with spaces to match width
-                while (lineNumberPart.size() < static_cast<size_t>(std::to_string(std::max(1, (int)lines.size())).length()))
-                    lineNumberPart = " " + lineNumberPart;
-        
-                // Add separator between line number and actual line content
-                lineNumberPart += " | ";
-        
-                // Construct the line display
-                std::string displayLine = lineNumberPart;
-        
-                if (fileRow < (int)lines.size()) {
-                    std::string& line = lines[fileRow];
-        
-                    // Cut off by column offset and screen width minus the line number gutter
-                    int lineEnd = std::min((int)line.size(), colOffset + screenCols - (int)displayLine.size());
-                    for (int x = colOffset; x < lineEnd; ++x) {
-                        displayLine += line[x];  // Add each character within the visible range
+                // Which file row this screen row shows, and which of its columns: with soft wrap one
+                // segment of a line, otherwise what fits right of the column offset
+                int fileRow = softWrap ? wrapLine : y + rowOffset;
+                int lineStart = colOffset, lineEnd = colOffset;
+                bool continuation = false;
+                if (fileRow < (int)lines.size() && softWrap) {
+                    lineStart = wrapLayout.segmentStart(lines, fileRow, wrapSegment);
+                    lineEnd = wrapLayout.segmentEnd(lines, fileRow, wrapSegment);
+                    continuation = wrapSegment > 0;
+                    if (++wrapSegment >= wrapLayout.rowsOf(fileRow)) {
+                        ++wrapLine;
+                        wrapSegment = 0;
                     }
+                } else if (fileRow < (int)lines.size()) {
+                    lineEnd = std::min((int)lines[fileRow].size(), colOffset + screenCols - gutterWidth - minimapColumns());
                 }
         
-                // Pad the rest with spaces if the line is shorter than the screen width
-                if ((int)displayLine.size() < screenCols) {
-                    displayLine += std::string(screenCols - displayLine.size(), ' ');  // Pad the end of the line with spaces
+                // Line number (1-based), right-aligned; an empty line is indicated by a tilde, a wrapped row by nothing
+                if (continuation) {
+                    // Blank gutter
+                } else if (fileRow < (int)lines.size()) {
+                    int len = formatDecimal(fileRow + 1, lineNumber);
+                    screen.text(y, lineNumberWidth - len, std::string_view(lineNumber, len), TEXT_COLOR);
+                } else {
+                    screen.text(y, lineNumberWidth - 1, "~", TEXT_COLOR);
                 }
         
-                buffer << displayLine;  // Append the final line content to the buffer
-            }
-        
-            // Draw the status bar at the bottom
-            drawStatusBar(buffer);
-        
-            // Get the entire buffer as a string
-            std::string output = buffer.str();
-        
-            // Handle cursor position (moving the cursor to the correct position on the screen)
-            HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-        
-            // Create a buffer of attributes for the text (initially set to normal foreground colors)
-            std::vector<WORD> attributes(output.size(), FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-        
-            int lineNumberWidth = std::to_string(std::max(1, (int)lines.size())).length();  // Width of line number gutter
-            int gutterWidth = lineNumberWidth + 3;  // 3 for the separator " | "
-
-            // Tokenize each line and apply keyword colors
-            for (int y = 0; y < screenRows - 1; ++y) {
-                int fileRow = y + rowOffset;
+                // Add separator between line number and actual line content
+                screen.text(y, lineNumberWidth, " | ", TEXT_COLOR);
                 if (fileRow >= (int)lines.size()) continue;
 
-                std::string& line = lines[fileRow];
-                int lineEnd = std::min((int)line.size(), colOffset + screenCols - gutterWidth);
-
-                int x = colOffset;
-                bool inString = false;  // Track if inside " or ' string
-
-                while (x < lineEnd) {
-                    int bufferPos = y * screenCols + (x - colOffset);
-
-                    if (!syntaxHighlighting) {
-                        attributes[bufferPos + gutterWidth] = DEFAULT_COLOR;  // Default color for normal text
-                        ++x;
-                        continue;
-                    }
-
-                    // Handle string literals (single or double quotes)
-                    if (line[x] == '"' || line[x] == '\'') {
-                        inString = !inString;  // Toggle string mode
-                        ++x;
-                        continue;
-                    }
-
-                    // If inside a string, color it blue
-                    if (inString) {
-                        int start = x;
-                        while (x < lineEnd && line[x] != '"' && line[x] != '\'') {
-                            ++x;
-                        }
-                        for (int i = start; i < x; ++i) {
-                            int bufferPosStr = y * screenCols + (i - colOffset);
-                            attributes[bufferPosStr + gutterWidth] = TYPE_COLOR;
-                        }
-                        continue;
-                    }
-
-                    // Handle comments
-                    if (line[x] == '/' && x + 1 < lineEnd && line[x + 1] == '/') {
-                        while (x < lineEnd) {
-                            int commentPos = y * screenCols + (x - colOffset);
-                            attributes[commentPos + gutterWidth] = MISC_COLOR;
-                            ++x;
-                        }
-                        continue;
-                    }
+                // Cut off by column offset and screen width minus the line number gutter; the rest of the row stays blank
+                const std::string& line = lines[fileRow];
+                shownTo = fileRow + 1;
+                if (lineEnd <= lineStart) continue;
+                screen.text(y, gutterWidth, std::string_view(line).substr(lineStart, lineEnd - lineStart), baseColor);
 
-                    // Handle angle-bracketed content
-                    if (line[x] == '<') {
-                        int start = x;
-                        int endPos = line.find('>', x + 1);
-                        if (static_cast<std::size_t>(endPos) != std::string::npos
-                            && static_cast<std::size_t>(endPos) < static_cast<std::size_t>(lineEnd)) {
-                            for (int i = start; i <= endPos; ++i) {
-                                int bufferPosBracket = y * screenCols + (i - colOffset);
-                                attributes[bufferPosBracket + gutterWidth] = FOREGROUND_RED | FOREGROUND_INTENSITY;
-                            }
-                            x = endPos + 1;
-                            continue;
-                        }
+                // Syntax colors first, then the overlays on top of them. A wrapped row is highlighted
+                // from the start of its line so strings and comments carry over from the rows above.
+                lineStyle.reset(lineStart, lineEnd);
+                auto stageStart = PerformanceGovernor::Clock::now();
+                if (syntaxHighlighting && !governor.skipHighlight(line.size())) {
+                    // Whole-line tokens from the highlighter, as far as it has got; only the ones
+                    // reaching into [lineStart, lineEnd) are copied. A line it has not got to yet is
+                    // drawn plain (or with its colors from before an edit) and redrawn once it has.
+                    bool current = false;
+                    if (const std::vector<StyleSpan>* tokens = syntaxCache.cachedSpans(fileRow, current)) {
+                        auto token = std::lower_bound(tokens->begin(), tokens->end(), lineStart,
+                                                      [](const StyleSpan& span, int column) { return span.to <= column; });
+                        for (; token != tokens->end() && token->from < lineEnd; ++token) lineStyle.add(token->from, token->to, token->attr);
                     }
+                    if (!current) visibleStale = true;
+                    governor.charge(PerformanceGovernor::HIGHLIGHT, stageStart);
+                    stageStart = PerformanceGovernor::Clock::now();
+                }
 
-                    // Handle std::
-                    if (line.substr(x, 5) == "std::") {
-                        int start = x;
-                        x += 5;
-                        for (int i = start; i < x; ++i) {
-                            int bufferPosStd = y * screenCols + (i - colOffset);
-                            attributes[bufferPosStd + gutterWidth] = FOREGROUND_RED;
-                        }
-                        continue;
-                    }
+                // Watch-list terms: one automaton pass, started early enough to catch terms that begin
+                // left of the viewport and ended late enough for ones that run past it
+                bool overlays = !governor.skipOverlays();
+                if (overlays && !watchAutomaton.empty()) {
+                    int reach = watchAutomaton.maxTermLength() - 1;
+                    watchSpans.clear();
+                    watchAutomaton.findSpans(line, std::max(0, lineStart - reach),
+                                             std::min((int)line.size(), lineEnd + reach), watchSpans);
+                    lineStyle.overlay(watchSpans.data(), watchSpans.size(), baseColor,
+                                      [](WORD attr) { return overlayColor(attr, WATCH_COLOR); });
+                }
 
-                    // Handle operators
-                    static const std::vector<std::string> operators = {
-                        "==", "!=", "<=", ">=", "->", "::",
-                        "+", "-", "*", "/", "%", "=", "<", ">", "&", "|", "^", "~", "!", "++", "--",
-                        "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "<<", ">>", "<<=", ">>="
-                    };
-
-                    bool matchedOp = false;
-                    for (const auto& op : operators) {
-                        if (line.compare(x, op.size(), op) == 0) {
-                            for (int i = 0; i < (int)op.size(); ++i) {
-                                int pos = y * screenCols + (x + i - colOffset);
-                                if (pos + gutterWidth < (int)attributes.size()) {
-                                    attributes[pos + gutterWidth] = OPERATOR_COLOR;
-                                }
-                            }
-                            x += op.size();
-                            matchedOp = true;
-                            break;
-                        }
+                // Every visible occurrence of the active search query. Hits are sorted, so jump
+                // straight to the first one that reaches into the viewport.
+                if (overlays && searchActive && !searchQuery.empty()) {
+                    int queryLength = matchIndex.queryLength();
+                    const std::vector<int>& hits = matchIndex.lineMatches(lines, fileRow);
+                    overlayRanges.clear();
+                    for (auto hit = std::lower_bound(hits.begin(), hits.end(), lineStart - queryLength + 1);
+                         hit != hits.end() && *hit < lineEnd; ++hit) {
+                        overlayRanges.emplace_back(*hit, *hit + queryLength);
                     }
-                    if (matchedOp) continue;
+                    lineStyle.overlay(overlayRanges.data(), overlayRanges.size(), baseColor,
+                                      [](WORD attr) { return overlayColor(attr, MATCH_COLOR); });
+                }
+                if (overlays) governor.charge(PerformanceGovernor::OVERLAYS, stageStart);
 
-                    // Handle identifiers and keywords
-                    if (std::isalpha(line[x]) || line[x] == '_') {
-                        int start = x;
-                        while (x < lineEnd && (std::isalnum(line[x]) || line[x] == '_')) {
-                            ++x;
-                        }
-                        std::string token = line.substr(start, x - start);
+                // The matched bracket pair
+                if (bracketMatched) {
+                    auto paintBracket = [](WORD attr) { return overlayColor(attr, BRACKET_COLOR); };
+                    if (fileRow == cursorY) lineStyle.overlay(cursorX, cursorX + 1, baseColor, paintBracket);
+                    if (fileRow == bracketRow) lineStyle.overlay(bracketCol, bracketCol + 1, baseColor, paintBracket);
+                }
 
-                        // Handle std::
-                        if (token == "std" && x < lineEnd && line[x] == ':') {
-                            int bufferPosStdOnly = y * screenCols + (start - colOffset);
-                            attributes[bufferPosStdOnly + gutterWidth] = FOREGROUND_RED;
-                            continue;
-                        }
+                // Selection highlight (blue background with normal text) replaces whatever is under it
+                if (hasSelection && fileRow >= startY && fileRow <= endY) {
+                    int from = (fileRow == startY) ? startX : 0;
+                    int to = (fileRow == endY) ? endX : (int)line.size();
+                    lineStyle.overlay(from, to, baseColor, [](WORD) { return (WORD)(HIGHLIGHT_COLOR | DEFAULT_COLOR); });
+                }
 
-                        auto it = cxxKeywords.find(token);
-                        if (it != cxxKeywords.end()) {
-                            WORD tokenColor;
-                            const std::string &cat = it->second;
-                            if      (cat == "Type")                tokenColor = TYPE_COLOR;
-                            else if (cat == "Type Modifier")       tokenColor = TYPE_MODIFIER_COLOR;
-                            else if (cat == "Cast")                tokenColor = CAST_COLOR;
-                            else if (cat == "Cast/Introspection")  tokenColor = CAST_COLOR;
-                            else if (cat == "Control Flow")        tokenColor = CONTROL_FLOW_COLOR;
-                            else if (cat == "Operator")            tokenColor = OPERATOR_COLOR;
-                            else if (cat == "Operator Overloading")tokenColor = OPERATOR_COLOR;
-                            else if (cat == "Memory Management")   tokenColor = MEMORY_MANAGEMENT_COLOR;
-                            else if (cat == "Exception Handling")  tokenColor = EXCEPTION_HANDLING_COLOR;
-                            else if (cat == "Object-Oriented")     tokenColor = OOP_COLOR;
-                            else if (cat == "Template")            tokenColor = TEMPLATE_COLOR;
-                            else if (cat == "Namespace")           tokenColor = NAMESPACE_COLOR;
-                            else if (cat == "Coroutines")          tokenColor = COROUTINE_COLOR;
-                            else if (cat == "Concepts")            tokenColor = CONCEPT_COLOR;
-                            else if (cat == "Boolean Literal")     tokenColor = BOOLEAN_LITERAL_COLOR;
-                            else if (cat == "Null/Undefined")      tokenColor = NULL_COLOR;
-                            else if (cat == "Preprocessor")        tokenColor = PREPROCESSOR_COLOR;
-                            else if (cat == "Miscellaneous")       tokenColor = MISC_COLOR;
-                            else                                   tokenColor = DEFAULT_COLOR;                            
-
-                            for (int i = start; i < x; ++i) {
-                                int bufferPosToken = y * screenCols + (i - colOffset);
-                                attributes[bufferPosToken + gutterWidth] = tokenColor;
-                            }
-                        }
-                    } else {
-                        ++x;
-                    }
+                // Paint span by span; a plain line has nothing left to do here
+                for (const StyleSpan& span : lineStyle.get()) {
+                    screen.fillAttr(y, gutterWidth + span.from - lineStart, span.to - span.from, span.attr);
                 }
             }
         
-            // Set selection attributes (highlight selected text with background color)
-            if (hasSelection) {
-                for (int y = 0; y < screenRows - 1; ++y) {  // Loop through the rows again to apply selection highlights
-                    int fileRow = y + rowOffset;
-                    if (fileRow < (int)lines.size()) {
-                        for (int x = 0; x < screenCols && x + colOffset < (int)lines[fileRow].size(); ++x) {
-                            int bufferPos = y * screenCols + x;
-                            if (bufferPos < (int)attributes.size()) {
-                                // Check if the current position is within the selection range
-                                bool isSelected = ((fileRow > startY && fileRow < endY) ||
-                                                (fileRow == startY && fileRow == endY && x + colOffset >= startX && x + colOffset < endX) ||
-                                                (fileRow == startY && fileRow != endY && x + colOffset >= startX) ||
-                                                (fileRow == endY && fileRow != startY && x + colOffset < endX));
-        
-                                // Set selection highlight (blue background with normal text)
-                                if (isSelected) {
-                                    attributes[bufferPos + gutterWidth] = HIGHLIGHT_COLOR | 
-                                                                            DEFAULT_COLOR;
-                                }
-                            }
-                        }
-                    }
-                }
+            if (showMinimap) {
+                int visibleTo = softWrap ? wrapLine + (wrapSegment > 0 ? 1 : 0) : rowOffset + screenRows - 1;
+                drawMinimap(rowOffset, std::min(visibleTo, (int)lines.size()));
             }
+
+            // Draw the status bar at the bottom
+            drawStatusBar();
         
-            // Write the buffer (text) to console
-            DWORD written;
-            WriteConsoleOutputCharacterA(hOut, output.c_str(), output.size(), {0, 0}, &written);
+            // Leave the cursor at its current position (adjusted by rowOffset and colOffset) once the frame is presented
+            if (softWrap && cursorY < (int)lines.size()) {
+                int segment = wrapLayout.segmentOf(lines, cursorY, cursorX);
+                screen.setCursor(wrapLayout.rowOf(cursorY) + segment - topRow,
+                                 cursorX - wrapLayout.segmentStart(lines, cursorY, segment) + gutterWidth);
+            } else {
+                screen.setCursor(cursorY - rowOffset, cursorX - colOffset + gutterWidth);
+            }
+            governor.endFrame();
 
-            // Write the attributes to the console
-            for (int y = 0; y < screenRows; ++y) {
-                int startIdx = y * screenCols;
-                WriteConsoleOutputAttribute(hOut, &attributes[startIdx], screenCols, {0, (SHORT)y}, &written);
+            // Tell the highlighter what to work on first when the editor next waits for keys
+            if (highlightFrom != rowOffset || highlightTo != shownTo) {
+                highlightFrom = rowOffset;
+                highlightTo = shownTo;
+                surroundingsDone = false;
             }
-        
-            // Position the cursor based on its current position (adjusted by rowOffset and colOffset)
-            moveCursor(cursorY - rowOffset, cursorX - colOffset + gutterWidth);
         }        
 
+        // scroll() with soft wrap: keeps the cursor's wrapped row on screen. Only the lines within a
+        // screen of the cursor are laid out exactly; the tree answers for everything further away.
+        void scrollWrapped() {
+            syncWrapLayout();
+            colOffset = 0;
+            if (cursorY >= (int)lines.size()) return;
+            int textRows = screenRows - 1;
+            int cursorSegment = wrapLayout.segmentOf(lines, cursorY, cursorX);
+
+            // Cursor above the window: its row becomes the top one
+            if (cursorY < rowOffset || (cursorY == rowOffset && cursorSegment < rowSegment)) {
+                rowOffset = cursorY;
+                rowSegment = cursorSegment;
+                return;
+            }
+
+            // Cursor below the window: put its row at the bottom
+            for (int line = std::max(0, cursorY - textRows); line < cursorY; ++line) wrapLayout.layout(lines, line);
+            int cursorRow = wrapLayout.rowOf(cursorY) + cursorSegment;
+            if (cursorRow >= wrapLayout.rowOf(rowOffset) + rowSegment + textRows) {
+                std::tie(rowOffset, rowSegment) = wrapLayout.lineAtRow(cursorRow - textRows + 1);
+            }
+        }
+
         void scroll() {
+            if (softWrap) {
+                scrollWrapped();
+                return;
+            }
+
             // Vertical scroll: if cursor is above the visible area, move the window up
             if (cursorY < rowOffset) rowOffset = cursorY;
             
@@ -988,8 +5506,8 @@ class Nite {
                     colOffset = cursorX;
 
                 // If the cursor is past the right edge of the screen, move the window right
-                if (cursorX >= colOffset + screenCols)
-                    colOffset = cursorX - screenCols + 1;
+                if (cursorX >= colOffset + screenCols - minimapColumns())
+                    colOffset = cursorX - (screenCols - minimapColumns()) + 1;
             } else {
                 // If skipping horizontal scroll, reset the flag for next use
                 skipHorizontalScroll = false;
@@ -1006,6 +5524,13 @@ class Nite {
 
             // Ensure the row offset does not go below 0 (i.e., we can't scroll above the first line)
             rowOffset = std::max(0, targetRowOffset);
+            rowSegment = 0;
+
+            // With soft wrap the third of the screen is counted in wrapped rows, straight from the row tree
+            if (softWrap && !lines.empty()) {
+                syncWrapLayout();
+                std::tie(rowOffset, rowSegment) = wrapLayout.lineAtRow(wrapLayout.rowOf(lineNumber) - screenRows / 3);
+            }
 
             // Move the cursor to the specified line
             cursorY = lineNumber;
@@ -1017,8 +5542,8 @@ class Nite {
                     colOffset = cursorX;
                 
                 // If the cursor is to the right of the visible screen area, scroll right
-                if (cursorX >= colOffset + screenCols)
-                    colOffset = cursorX - screenCols + 1;
+                if (cursorX >= colOffset + screenCols - minimapColumns())
+                    colOffset = cursorX - (screenCols - minimapColumns()) + 1;
             } else {
                 // Reset the skip flag if horizontal scroll was previously skipped
                 skipHorizontalScroll = false;
@@ -1033,7 +5558,9 @@ class Nite {
 
             // Ensure the lines vector has enough rows to accommodate the cursor position
             if (cursorY >= (int)lines.size()) {
+                int oldSize = (int)lines.size();
                 lines.resize(cursorY + 1);  // Add empty lines as needed
+                linesInserted(oldSize, cursorY + 1 - oldSize);
             }
 
             // Store the current state before making changes for undo/redo functionality
@@ -1051,6 +5578,7 @@ class Nite {
 
             // Insert the character at the cursor position
             lines[cursorY].insert(lines[cursorY].begin() + cursorX, c);
+            lineChanged(cursorY);
 
             // Move the cursor to the right after insertion
             cursorX++;
@@ -1096,6 +5624,7 @@ class Nite {
 
                 // Erase the character before the cursor (cursorX - 1)
                 lines[cursorY].erase(lines[cursorY].begin() + cursorX - 1);
+                lineChanged(cursorY);
                 
                 // Move the cursor left by one character
                 cursorX--;
@@ -1123,6 +5652,8 @@ class Nite {
 
                 // Erase the current line (cursorY) after merging
                 lines.erase(lines.begin() + cursorY);
+                lineChanged(cursorY - 1);
+                linesErased(cursorY, 1);
 
                 // Move the cursor to the previous line and adjust the column position
                 cursorY--;
@@ -1165,7 +5696,9 @@ class Nite {
 
             // Ensure the current line exists (resize lines if needed)
             if (cursorY >= (int)lines.size()) {
+                int oldSize = (int)lines.size();
                 lines.resize(cursorY + 1);  // Resize lines vector to accommodate the current row
+                linesInserted(oldSize, cursorY + 1 - oldSize);
             }
 
             // If the cursor is beyond the length of the current line, adjust cursor position
@@ -1180,6 +5713,8 @@ class Nite {
             std::string newLine = current.substr(cursorX);  // Everything after the cursor becomes the new line
             lines[cursorY] = current.substr(0, cursorX);  // The part before the cursor stays in the current line
             lines.insert(lines.begin() + cursorY + 1, newLine);  // Insert the new line after the current line
+            lineChanged(cursorY);
+            linesInserted(cursorY + 1, 1);
 
             // Record the action for undo
             Action action;
@@ -1262,6 +5797,7 @@ class Nite {
             // Handle single line selection
             if (startY == endY) {
                 lines[startY].erase(startX, endX - startX);  // Erase the selected text from the line
+                lineChanged(startY);
                 cursorX = startX;  // Move cursor to the beginning of the remaining text (after deletion)
                 cursorY = startY;  // Keep the cursor on the same line
             }
@@ -1281,6 +5817,8 @@ class Nite {
                 
                 // Remove the lines in between the selected range (i.e., from startY + 1 to endY inclusive)
                 lines.erase(lines.begin() + startY + 1, lines.begin() + endY + 1);
+                lineChanged(startY);
+                linesErased(startY + 1, endY - startY);
                 
                 // Set cursor position to the start of the remaining text
                 cursorX = startX;
@@ -1299,6 +5837,9 @@ class Nite {
             
             std::string selectedText = getSelectedText();  // Get the selected text from the editor
             
+#ifndef _WIN32
+            clipboard = selectedText;  // No system clipboard API on a plain terminal: keep it inside the editor
+#else
             // Open the clipboard and clear its contents
             if (!OpenClipboard(NULL)) return;
             EmptyClipboard();
@@ -1317,6 +5858,7 @@ class Nite {
             // Set the clipboard data to the copied text and close the clipboard
             SetClipboardData(CF_TEXT, hMem);
             CloseClipboard();
+#endif
         }        
     
         void cutSelection() {
@@ -1332,6 +5874,9 @@ class Nite {
                 deleteSelection();
             }
         
+#ifndef _WIN32
+            std::string clipboardText = clipboard;
+#else
             // Open clipboard
             if (!OpenClipboard(NULL)) return;
         
@@ -1352,6 +5897,7 @@ class Nite {
             std::string clipboardText = pText;
             GlobalUnlock(hData);
             CloseClipboard();
+#endif
         
             // Insert the clipboard text
             Action action;
@@ -1417,13 +5963,17 @@ class Nite {
                     }
                     break;
                 case 72: // Up
-                    if (cursorY > 0) {
+                    if (softWrap) {
+                        moveCursorRows(-1);  // One wrapped row, not one line
+                    } else if (cursorY > 0) {
                         cursorY--;
                         cursorX = std::min(cursorX, (int)lines[cursorY].size());
                     }
                     break;
                 case 80: // Down
-                    if (cursorY + 1 < (int)lines.size()) {
+                    if (softWrap) {
+                        moveCursorRows(1);
+                    } else if (cursorY + 1 < (int)lines.size()) {
                         cursorY++;
                         cursorX = std::min(cursorX, (int)lines[cursorY].size());
                     }
@@ -1436,11 +5986,19 @@ class Nite {
                         cursorX = (int)lines[cursorY].size();
                     break;
                 case 73: // Page Up
+                    if (softWrap) {
+                        moveCursorRows(-(screenRows - 2));  // A page of wrapped rows
+                        break;
+                    }
                     cursorY = std::max(0, cursorY - (screenRows - 2));
                     if (cursorY < (int)lines.size())
                         cursorX = std::min(cursorX, (int)lines[cursorY].size());
                     break;
                 case 81: // Page Down
+                    if (softWrap) {
+                        moveCursorRows(screenRows - 2);
+                        break;
+                    }
                     cursorY = std::min((int)lines.size() - 1, cursorY + (screenRows - 2));
                     if (cursorY < (int)lines.size())
                         cursorX = std::min(cursorX, (int)lines[cursorY].size());
@@ -1527,79 +6085,20 @@ class Nite {
         }        
 
         void search() {
-            // Clear the console at the bottom for input
-            moveCursor(screenRows - 1, 0);  // Move cursor to the last line, first column
-            std::cout << std::string(screenCols, ' ');  // Clear the entire line
-            moveCursor(screenRows - 1, 0);  // Move cursor back to the beginning
-            std::cout << "Search: ";  // Print prompt
-            
-            // Get search input from the user
-            std::string query;  // The query the user is typing
-            char c;  // Variable to store each character typed by the user
-            
-            // Loop to read characters until Enter is pressed (carriage return - '\r')
-            while ((c = _getch()) != '\r') {
-                if (c == 27) { // ESC - cancel the search operation
-                    searchActive = false;
-                    return;
-                } else if (c == 8) { // Backspace key to delete the last character
-                    if (!query.empty()) {
-                        query.pop_back();  // Remove the last character from the query
-                        // Update the display
-                        moveCursor(screenRows - 1, 0);  // Move cursor back to the beginning
-                        std::cout << "Search: " << query << ' ';  // Redraw the search prompt
-                    }
-                } else if (c >= 32 && c <= 126) { // Only allow printable characters
-                    query += c;  // Add the typed character to the query string
-                    // Update the display, moving cursor accordingly
-                    moveCursor(screenRows - 1, 8 + query.size() - 1);  // Move cursor to the end of typed query
-                    std::cout << c;  // Output the typed character
-                }
-            }
-            
-            // When Enter is pressed, search is triggered
-            if (!query.empty()) {
-                searchQuery = query;  // Set the search query
-                searchActive = true;  // Mark the search as active
-                lastSearchLine = -1;  // Reset the last search line position
-                lastSearchPos = -1;  // Reset the last search position
-                findNext();  // Perform the actual search
-            }
+            startStatusInput("Search: ", SEARCH_FILE);  // The query is typed in the status bar; Enter jumps to the first match
         }        
 
         void replaceAll() {
-            // If we don't have a search query yet, do a search first
+            // If we don't have a search query yet, ask for one first; the replacement prompt follows it
             if (searchQuery.empty()) {
-                search();  // Prompt the user to input a search query
-                if (searchQuery.empty()) return;  // If no query is entered, return
-            }
-        
-            // Get the replacement text from the user
-            moveCursor(screenRows - 1, 0);
-            std::cout << std::string(screenCols, ' ');  // Clear the line
-            moveCursor(screenRows - 1, 0);
-            std::cout << "Replace all with: ";  // Display prompt for replacement text
-        
-            std::string replaceText;  // The replacement text
-            char c;
-            
-            // Loop to gather user input for the replacement text
-            while ((c = _getch()) != '\r') {  // Wait for user input until Enter is pressed
-                if (c == 27) {  // ESC - cancel the replace operation
-                    return;
-                } else if (c == 8) {  // Backspace to remove a character
-                    if (!replaceText.empty()) {
-                        replaceText.pop_back();  // Remove last character
-                        moveCursor(screenRows - 1, 0);
-                        std::cout << "Replace all with: " << replaceText << ' ';  // Update display
-                    }
-                } else if (c >= 32 && c <= 126) {  // Printable characters
-                    replaceText += c;  // Add the character to the replacement text
-                    moveCursor(screenRows - 1, 17 + replaceText.size() - 1);  // Move cursor
-                    std::cout << c;  // Display the character
-                }
+                startStatusInput("Search: ", REPLACE_FILE_FIND);
+            } else {
+                startStatusInput("Replace all with: ", REPLACE_FILE_WITH);
             }
-        
+        }
+
+        // Replaces every occurrence of the search query in the document as a single undoable action
+        void replaceAllWith(const std::string& replaceText) {
             // Create an action to support undo/redo functionality
             Action action;
             action.type = Action::ReplaceAll;
@@ -1617,6 +6116,7 @@ class Nite {
                 while ((pos = line.find(searchQuery, pos)) != std::string::npos) {
                     // Replace the found occurrence with the replacement text
                     line.replace(pos, searchQuery.length(), replaceText);
+                    lineChanged(i);
         
                     // Move position forward to continue searching beyond the current replacement
                     pos += replaceText.length();
@@ -1632,18 +6132,10 @@ class Nite {
                 dirty = true;  // Mark the document as dirty (modified)
         
                 // Show the number of replacements in the status bar
-                moveCursor(screenRows - 1, 0);
-                std::cout << std::string(screenCols, ' ');  // Clear the status line
-                moveCursor(screenRows - 1, 0);
-                std::cout << "Replaced " << replacementCount << " occurrences.";
-                _getch();  // Wait for a key press before continuing
+                statusMessage = "Replaced " + std::to_string(replacementCount) + " occurrences.";
             } else {
                 // If no replacements were made, display a message
-                moveCursor(screenRows - 1, 0);
-                std::cout << std::string(screenCols, ' ');  // Clear the status line
-                moveCursor(screenRows - 1, 0);
-                std::cout << "No occurrences found.";
-                _getch();  // Wait for a key press before continuing
+                statusMessage = "No occurrences found.";
             }
         
             // Cancel selection if any
@@ -1688,6 +6180,7 @@ class Nite {
         
             // 5) Read into your lines buffer
             lines.clear();
+            linesReset();
             std::string line;
             while (std::getline(file, line)) {
                 lines.push_back(line);
@@ -1735,6 +6228,7 @@ class Nite {
                     if (action.cursorY >= 0 && action.cursorY < (int)lines.size() && 
                         action.cursorX > 0 && action.cursorX <= (int)lines[action.cursorY].size()) {
                         lines[action.cursorY].erase(action.cursorX - 1, 1);
+                        lineChanged(action.cursorY);
                         cursorX = action.cursorX - 1;
                         cursorY = action.cursorY;
                     }
@@ -1744,6 +6238,7 @@ class Nite {
                     if (action.cursorY >= 0 && action.cursorY < (int)lines.size() && 
                         action.cursorX >= 0 && action.cursorX <= (int)lines[action.cursorY].size()) {
                         lines[action.cursorY].insert(action.cursorX - 1, action.oldText);
+                        lineChanged(action.cursorY);
                         cursorX = action.cursorX;
                         cursorY = action.cursorY;
                     }
@@ -1753,6 +6248,8 @@ class Nite {
                     if (action.cursorY >= 0 && action.cursorY < (int)lines.size() - 1) {
                         lines[action.cursorY] += lines[action.cursorY + 1];
                         lines.erase(lines.begin() + action.cursorY + 1);
+                        lineChanged(action.cursorY);
+                        linesErased(action.cursorY + 1, 1);
                         cursorX = action.cursorX;
                         cursorY = action.cursorY;
                     }
@@ -1766,6 +6263,8 @@ class Nite {
                         
                         lines[action.cursorY] = startPart;
                         lines.insert(lines.begin() + action.cursorY + 1, action.oldText + endPart);
+                        lineChanged(action.cursorY);
+                        linesInserted(action.cursorY + 1, 1);
                         
                         cursorX = 0;
                         cursorY = action.cursorY + 1;
@@ -1782,6 +6281,7 @@ class Nite {
                         // Single line selection
                         if (action.selStartY == action.selEndY) {
                             lines[action.selStartY].insert(action.selStartX, action.oldText);
+                            lineChanged(action.selStartY);
                             cursorX = action.selEndX;
                             cursorY = action.selEndY;
                             selectionStartX = action.selStartX;
@@ -1811,6 +6311,8 @@ class Nite {
                                 }
                                 int lastLineIndex = action.selStartY + newLines.size() - 1;
                                 lines[lastLineIndex] += lastPart;
+                                lineChanged(action.selStartY);
+                                linesInserted(action.selStartY + 1, (int)newLines.size() - 1);
                                 
                                 cursorX = action.selEndX;
                                 cursorY = action.selEndY;
@@ -1832,6 +6334,7 @@ class Nite {
                         while ((pos = line.find(action.text, pos)) != std::string::npos) {
                             line.replace(pos, action.text.length(), action.oldText);
                             pos += action.oldText.length();
+                            lineChanged(i);
                         }
                     }
                     break;
@@ -1855,6 +6358,7 @@ class Nite {
                     if (action.cursorY >= 0 && action.cursorY < (int)lines.size() && 
                         action.cursorX >= 0 && action.cursorX <= (int)lines[action.cursorY].size()) {
                         lines[action.cursorY].insert(action.cursorX, action.text);
+                        lineChanged(action.cursorY);
                         cursorX = action.cursorX + 1;
                         cursorY = action.cursorY;
                     }
@@ -1863,6 +6367,7 @@ class Nite {
                     if (action.cursorY >= 0 && action.cursorY < (int)lines.size() && 
                         action.cursorX > 0 && action.cursorX <= (int)lines[action.cursorY].size()) {
                         lines[action.cursorY].erase(action.cursorX - 1, 1);
+                        lineChanged(action.cursorY);
                         cursorX = action.cursorX - 1;
                         cursorY = action.cursorY;
                     }
@@ -1875,6 +6380,8 @@ class Nite {
                         
                         lines[action.cursorY] = firstPart;
                         lines.insert(lines.begin() + action.cursorY + 1, action.text + lastPart);
+                        lineChanged(action.cursorY);
+                        linesInserted(action.cursorY + 1, 1);
                         
                         cursorX = 0;
                         cursorY = action.cursorY + 1;
@@ -1884,6 +6391,8 @@ class Nite {
                     if (action.cursorY > 0 && action.cursorY < (int)lines.size()) {
                         lines[action.cursorY - 1] += lines[action.cursorY];
                         lines.erase(lines.begin() + action.cursorY);
+                        lineChanged(action.cursorY - 1);
+                        linesErased(action.cursorY, 1);
                         
                         cursorX = action.cursorX;
                         cursorY = action.cursorY - 1;
@@ -1917,6 +6426,7 @@ class Nite {
                         while ((pos = line.find(action.oldText, pos)) != std::string::npos) {
                             // Replace with the replacement text
                             line.replace(pos, action.oldText.length(), action.text);
+                            lineChanged(i);
                             
                             // Move position forward
                             pos += action.text.length();
@@ -1928,12 +6438,93 @@ class Nite {
             undoStack.push_back(action);  // Push the redone action to the undo stack
         }        
 
+        // Starts grepping `directory` in the background and switches to the results list
+        void startProjectSearch(const fs::path& directory, const std::string& query) {
+            projectSearch.reset();  // Cancels and joins any search that is still running
+            projectSearch = std::make_unique<ProjectSearch>(directory, query);
+            showSearchResults();
+        }
+
+        void showSearchResults() {
+            if (!projectSearch) return;
+            inSearchResultsMode = true;
+            showingReplacePreview = false;
+            searchResultsFinalShown = false;
+            searchResultsView = std::make_unique<SearchResultsView>(screenRows, screenCols);
+        }
+
+        // Starts the dry run of a directory replace and shows its per-file preview
+        void startProjectReplace(const fs::path& directory, const std::string& find, const std::string& replaceWith) {
+            if (find.empty()) return;
+            projectReplace.reset();
+            projectReplace = std::make_unique<ProjectReplace>(directory, find, replaceWith);
+            inSearchResultsMode = true;
+            showingReplacePreview = true;
+            searchResultsFinalShown = false;
+            searchResultsView = std::make_unique<SearchResultsView>(screenRows, screenCols);
+        }
+
+        // Leaves the results list; after an applied replace the open file is reloaded if it was rewritten
+        void closeSearchResults() {
+            inSearchResultsMode = false;
+            if (showingReplacePreview && !dirty && !filename.empty() && projectReplace->touched(filename)) {
+                int keepX = cursorX, keepY = cursorY;
+                openFileFromPath(filename);
+                cursorY = std::min(keepY, (int)lines.size() - 1);
+                cursorX = std::min(keepX, (int)lines[cursorY].size());
+                scroll();
+            }
+        }
+
+        bool searchResultsBusy() {
+            return showingReplacePreview ? projectReplace->isBusy() : !projectSearch->isFinished();
+        }
+
+        // Opens the file of the selected hit and puts the cursor on the match
+        void openSearchHit() {
+            std::vector<SearchHit> hit = projectSearch->getHits().get(searchResultsView->getSelectedIndex(), 1);
+            if (hit.empty()) return;
+
+            inSearchResultsMode = false;
+            openFileFromPath(hit[0].path);
+            cursorX = hit[0].column;
+            scrollToLine(hit[0].line);
+
+            // Keep the query highlighted in the opened file
+            searchQuery = projectSearch->getQuery();
+            searchActive = true;
+            lastSearchLine = cursorY;
+            lastSearchPos = cursorX;
+        }
+
         void render() {
-            if (inFileBrowserMode) {
+#ifdef NITE_DEBUG_ALLOCS
+            size_t allocationsBefore = allocationCount;
+#endif
+            terminal->frameStarting();  // No-op after a key; a frame drawn while idle (colors arriving) starts here
+            if (inFuzzyFinderMode) {
+                fuzzyFinder->draw();
+            } else if (inSearchResultsMode && showingReplacePreview) {
+                searchResultsView->draw("Replace \"" + projectReplace->getQuery() + "\" with \"" + projectReplace->getReplacement() +
+                                        "\" in " + projectReplace->getRoot().string(),
+                                        projectReplace->getFiles(), projectReplace->summary());
+            } else if (inSearchResultsMode) {
+                bool finished = projectSearch->isFinished();
+                searchResultsView->draw("Search \"" + projectSearch->getQuery() + "\" in " + projectSearch->getRoot().string() +
+                                        (finished ? "" : "  [searching...]"),
+                                        projectSearch->getHits(), projectSearch->summary() + "  [Enter] Open  [Esc] Close");
+            } else if (inFileBrowserMode) {
                 fileNavigator->drawFileBrowser();
             } else {
                 drawEditor();
             }
+            screen.palette = themePalette;
+            renderer.publish(screen);  // The render thread writes it out; the editor carries on with the next key
+#ifdef NITE_DEBUG_ALLOCS
+            // Editor and browser frames should not allocate once the buffers have grown to size
+            ++framesDrawn;
+            if (allocationCount != allocationsBefore && !inFuzzyFinderMode && !inSearchResultsMode) ++framesAllocating;
+#endif
         } 
 
         void processInput() {
@@ -1941,218 +6532,347 @@ class Nite {
             scroll();
             render();  // Use render() instead of drawEditor() to handle both modes
         
+            // The text is only changed with documentMutex held; the highlighter gets it while we wait for keys
+            documentLock.lock();
+            highlighter.start(documentMutex, [this](HighlightWorker::Clock::time_point deadline) { return highlightSlice(deadline); });
+
             // Start an infinite loop to handle key input
             while (true) {
-                // Get the next character from input (key press)
-                int c = _getch();
-        
-                // If we're in file browser mode, handle file navigation
-                if (inFileBrowserMode) {
-                    bool shouldStayInBrowser = true;
-        
-                    if (c == 224) {  // Special key (like arrow keys)
-                        int c2 = _getch();  // Get the second part of the special key
-                        
-                        if (c2 == 72) {  // Up arrow
-                            fileNavigator->handleInput(VK_UP);
-                        } else if (c2 == 80) {  // Down arrow
-                            fileNavigator->handleInput(VK_DOWN);
-                        }
-                    } else if (c == '\r') {  // Enter key
-                        shouldStayInBrowser = fileNavigator->handleInput(VK_RETURN);
-                        
-                        if (!shouldStayInBrowser) {
-                            // User selected a file, open it
-                            fs::path selectedFile = fileNavigator->getSelectedFile();
-                            inFileBrowserMode = false;
-                            
-                            if (!selectedFile.empty()) {
-                                // Open the selected file
-                                openFileFromPath(selectedFile.string());
-                            }
-                        }
-                    } else if (c == 27) {  // Escape key
-                        inFileBrowserMode = false;  // Exit file browser mode
-                    }
-                    
-                    render();  // Update the display
-                    if (!inFileBrowserMode) {
-                        continue;  // Continue to the next iteration if we just exited file browser
-                    }
-                    
-                    continue;  // Skip the rest of the loop when in file browser mode
-                }
-        
-                // If we're waiting for input in the status bar (like filename, line number, etc.)
-                if (waitingForInput) {
-                    // Handle special input cases for the status bar (like filename input)
-                    if (c == 27) {  // Escape key - cancel input
-                        waitingForInput = false;
-                        statusPrompt = "";
-                        statusInput = "";
-                        currentInputType = NONE;
-                        processingInput = false;
-                    } else if (c == '\r') {  // Enter key - submit input
-                        processStatusInput();
-                    } else if (c == 8) {  // Backspace key - remove last character from input
-                        if (!statusInput.empty()) {
-                            statusInput.pop_back();
-                        }
-                    } else if (c >= 32 && c <= 126) {  // Printable characters
-                        // Append the character to the current status input
-                        statusInput += (char)c;
+                // While waiting for keys: let the highlighter color the lines on screen (drawing them
+                // again as soon as it has) and then lay down lexer checkpoints, so a jump anywhere in
+                // the file highlights at once; and bring back whatever the governor cut back
+                while (!terminal->keyAvailable()) {
+                    if (highlightWorkLeft()) {
+                        if (highlighter.idle(documentLock, std::chrono::milliseconds(5))) render();
+                    } else if (governor.restoreIfIdle()) {
+                        render();
+                    } else if (governor.isReducing()) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    } else {
+                        break;
                     }
-        
-                    // Recalculate the scroll and redraw the editor after status input
-                    scroll();
-                    render();
-                    continue;  // Continue to the next iteration if waiting for input
                 }
-        
-                // Check if Shift or Ctrl keys are pressed
-                bool shiftPressed = GetKeyState(VK_SHIFT) < 0;
-                bool ctrlPressed = GetKeyState(VK_CONTROL) < 0;
-        
-                // Handle Ctrl+Z (undo action)
-                if (c == 26) {  // ASCII value for Ctrl+Z
-                    undo();
-                }
-                // Handle Ctrl+Y (redo action)
-                else if (c == 25) {  // ASCII value for Ctrl+Y
-                    redo();
-                }
-                // Handle Ctrl+X (cut selection)
-                else if (c == 24) {  // ASCII value for Ctrl+X
-                    cutSelection();
-                }
-                // Handle Ctrl+C (copy selection)
-                else if (c == 3) {  // ASCII value for Ctrl+C
-                    copySelection();
+
+                // While a directory search is streaming results, repaint the list until a key arrives
+                while (inSearchResultsMode && !searchResultsFinalShown && !terminal->keyAvailable()) {
+                    bool finished = !searchResultsBusy();
+                    if (!finished) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    render();
+                    searchResultsFinalShown = finished;
                 }
-                // Handle Ctrl+V (paste from clipboard)
-                else if (c == 22) {  // ASCII value for Ctrl+V
-                    pasteFromClipboard();
+
+                // While the path index is being rebuilt, re-rank the open palette as soon as it lands
+                while (inFuzzyFinderMode && !terminal->keyAvailable()) {
+                    bool building = fuzzyFinder->isBuilding();
+                    if (fuzzyFinder->refreshIfIndexChanged()) render();
+                    if (!building) break;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
                 }
-                // Handle Ctrl+A (select all text)
-                else if (c == 1) {  // ASCII value for Ctrl+A
-                    // Select all the text in the document
-                    hasSelection = true;
-                    selectionStartX = 0;
-                    selectionStartY = 0;
-                    selectionEndX = lines.empty() ? 0 : lines.back().size();
-                    selectionEndY = lines.size() - 1;
-                    cursorX = selectionEndX;
-                    cursorY = selectionEndY;
-                }
-                // Handle special key input (like arrow keys, function keys, etc.)
-                else if (c == 224) {  // Special key (like arrow keys, etc.)
-                    int c2 = _getch();  // Get the second part of the special key
-        
-                    // Ignore control characters in the range [1, 31]
-                    if (c2 >= 1 && c2 <= 31) {
-                        continue;
+
+                // Apply every key that is already queued (key repeat, pastes, fast typing) before
+                // drawing again; a frame still goes out every FRAME_INTERVAL while keys keep coming
+                auto frameDeadline = std::chrono::steady_clock::now() + FRAME_INTERVAL;
+                bool running = true;
+                terminal->frameStarting();  // The frame for these keys starts now, not when the last one went out
+                do {
+                    running = handleKey(terminal->readKey());
+                } while (running && terminal->keyAvailable() && std::chrono::steady_clock::now() < frameDeadline);
+                if (!running) break;  // Exit the loop (quit)
+
+                // Ensure the scroll position and editor content are updated once per batch of keys
+                scroll();
+                render();
+            }
+            documentLock.unlock();
+            highlighter.stop();
+        }
+
+        // Applies one key press to whichever mode is active; returns false when the editor should quit
+        bool handleKey(int c) {
+            // The window changed size: lay out for it whatever mode is active (a prompt or message stays up)
+            if (c == KEY_RESIZE) {
+                applyWindowSize();
+                return true;
+            }
+
+            statusMessage.clear();  // One-off messages last until the next key
+
+            // If the fuzzy finder is open, keys edit its query or move through the matches
+            if (inFuzzyFinderMode) {
+                if (c == 224) {  // Special key (like arrow keys)
+                    int c2 = terminal->readKey();
+                    if (c2 == 72) fuzzyFinder->moveSelection(-1);       // Up arrow
+                    else if (c2 == 80) fuzzyFinder->moveSelection(1);   // Down arrow
+                } else if (c == '\r') {  // Enter key - open the selected file
+                    fs::path selectedFile = fuzzyFinder->getSelectedPath();
+                    inFuzzyFinderMode = false;
+                    if (!selectedFile.empty()) {
+                        openFileFromPath(selectedFile.string());
                     }
-        
-                    // Move the cursor according to the key pressed
-                    moveCursorKey(c2, shiftPressed);
-                }
-                // Handle Ctrl+F (find functionality)
-                else if (c == 6) {  // ASCII value for Ctrl+F
-                    search();
+                } else if (c == 27) {  // Escape key
+                    inFuzzyFinderMode = false;
+                } else if (c == 8) {  // Backspace key
+                    fuzzyFinder->backspace();
+                } else if (c >= 32 && c <= 126) {  // Printable characters extend the query
+                    fuzzyFinder->typeChar((char)c);
                 }
-                // Handle Ctrl+H (replace functionality)
-                else if (c == 8 && ctrlPressed) {  // Ctrl+H
-                    replaceAll();
-                }
-                // Handle Ctrl+N key for "Find Next"
-                else if (c == 14) {  // ASCII value for Ctrl+N
-                    findNext();
+
+                return true;  // Skip the rest of the handling when in fuzzy finder mode
+            }
+
+            // If we're in search results mode, handle result navigation
+            if (inSearchResultsMode) {
+                int count = (int)(showingReplacePreview ? projectReplace->getFiles() : projectSearch->getHits()).size();
+                int page = std::max(1, screenRows - 2);
+
+                if (c == 224) {  // Special key (like arrow keys)
+                    int c2 = terminal->readKey();
+                    if (c2 == 72) searchResultsView->moveSelection(-1, count);         // Up arrow
+                    else if (c2 == 80) searchResultsView->moveSelection(1, count);     // Down arrow
+                    else if (c2 == 73) searchResultsView->moveSelection(-page, count); // Page Up
+                    else if (c2 == 81) searchResultsView->moveSelection(page, count);  // Page Down
+                } else if (c == '\r' && showingReplacePreview) {  // Enter key - commit the previewed replace
+                    if (projectReplace->apply()) searchResultsFinalShown = false;
+                } else if (c == '\r') {  // Enter key - open the selected hit
+                    openSearchHit();
+                    scroll();
+                } else if (c == 27) {  // Escape key - back to the editor (Ctrl+E reopens search results)
+                    closeSearchResults();
                 }
-                // Handle Escape key (cancel selection or exit)
-                else if (c == 27) {  // Escape key
-                    if (hasSelection) {
-                        cancelSelection();  // Cancel any active selection
+
+                return true;  // Skip the rest of the handling when in search results mode
+            }
+    
+            // If we're in file browser mode, handle file navigation
+            if (inFileBrowserMode) {
+                bool shouldStayInBrowser = true;
+    
+                if (c == 224) {  // Special key (like arrow keys)
+                    int c2 = terminal->readKey();  // Get the second part of the special key
+                    
+                    if (c2 == 72) {  // Up arrow
+                        fileNavigator->handleInput(VK_UP);
+                    } else if (c2 == 80) {  // Down arrow
+                        fileNavigator->handleInput(VK_DOWN);
                     }
-                }
-                // Handle Tab key (insert tab)
-                else if (c == '\t') {  // Tab key
-                    insertTab();
-                }
-                // Handle Enter key (insert a new line)
-                else if (c == '\r') {  // Enter key
-                    insertNewLine();
-                }
-                // Handle Backspace key (delete the previous character)
-                else if (c == 8) {  // Backspace key
-                    deleteChar();
-                }
-                // Handle Delete key (delete a word)
-                else if (c == 127) {  // DEL key
-                    deleteWord();
-                }
-                // Handle Ctrl+S (save the file)
-                else if (c == 19) {  // Ctrl+S
-                    saveFile();
-                }
-                // Handle Ctrl+O (open a file using file browser)
-                else if (c == 15) {  // Ctrl+O
-                    // Use file browser mode instead of text input for opening files
-                    inFileBrowserMode = true;
-                    fileNavigator = std::make_unique<FileNavigator>(
-                        fs::current_path().string(),
-                        screenRows, screenCols
-                    );
-                }
-                // Handle Ctrl+. (Delete the selected text)
-                else if (c == 46 && ctrlPressed) {  // Ctrl+. (Delete selection)
-                    if (hasSelection) {
-                        deleteSelection();
+                } else if (c == '\r') {  // Enter key
+                    shouldStayInBrowser = fileNavigator->handleInput(VK_RETURN);
+                    
+                    if (!shouldStayInBrowser) {
+                        // User selected a file, open it
+                        fs::path selectedFile = fileNavigator->getSelectedFile();
+                        inFileBrowserMode = false;
+                        
+                        if (!selectedFile.empty()) {
+                            // Open the selected file
+                            openFileFromPath(selectedFile.string());
+                        }
                     }
+                } else if (c == 27) {  // Escape key
+                    inFileBrowserMode = false;  // Exit file browser mode
+                } else if (c == 6) {  // Ctrl+F - search every file below the directory being browsed
+                    searchRoot = fileNavigator->getCurrentDirectory();
+                    inFileBrowserMode = false;
+                    startStatusInput("Search in " + searchRoot.string() + ": ", SEARCH_DIRECTORY);
+                } else if (c == 8 && terminal->ctrlHeld()) {  // Ctrl+H - replace in every file below it
+                    searchRoot = fileNavigator->getCurrentDirectory();
+                    inFileBrowserMode = false;
+                    startStatusInput("Replace in " + searchRoot.string() + ": ", REPLACE_DIRECTORY_FIND);
                 }
-                // Handle Ctrl+Q (quit the editor)
-                else if (c == 17) {  // Ctrl+Q
-                    system("cls");
-                    break;  // Exit the loop (quit)
+                
+                return true;  // Skip the rest of the handling when in file browser mode
+            }
+    
+            // If we're waiting for input in the status bar (like filename, line number, etc.)
+            if (waitingForInput) {
+                // Handle special input cases for the status bar (like filename input)
+                if (c == 27) {  // Escape key - cancel input
+                    if (currentInputType == SEARCH_FILE) searchActive = false;  // Cancelling a search clears its highlighting
+                    waitingForInput = false;
+                    statusPrompt = "";
+                    statusInput = "";
+                    currentInputType = NONE;
+                    processingInput = false;
+                } else if (c == '\r') {  // Enter key - submit input
+                    processStatusInput();
+                } else if (c == 8) {  // Backspace key - remove last character from input
+                    if (!statusInput.empty()) {
+                        statusInput.pop_back();
+                    }
+                } else if (c >= 32 && c <= 126) {  // Printable characters
+                    // Append the character to the current status input
+                    statusInput += (char)c;
                 }
-                // Handle Ctrl+G (go to a specific line)
-                else if (c == 7) {
-                    startStatusInput("Enter line number to scroll to: ", GOTO_LINE);
+    
+                return true;  // Skip the rest of the handling while waiting for input
+            }
+    
+            // Check if Shift or Ctrl keys are pressed
+            bool shiftPressed = terminal->shiftHeld();
+            bool ctrlPressed = terminal->ctrlHeld();
+    
+            // Handle Ctrl+Z (undo action)
+            if (c == 26) {  // ASCII value for Ctrl+Z
+                undo();
+            }
+            // Handle Ctrl+Y (redo action)
+            else if (c == 25) {  // ASCII value for Ctrl+Y
+                redo();
+            }
+            // Handle Ctrl+X (cut selection)
+            else if (c == 24) {  // ASCII value for Ctrl+X
+                cutSelection();
+            }
+            // Handle Ctrl+C (copy selection)
+            else if (c == 3) {  // ASCII value for Ctrl+C
+                copySelection();
+            }
+            // Handle Ctrl+V (paste from clipboard)
+            else if (c == 22) {  // ASCII value for Ctrl+V
+                pasteFromClipboard();
+            }
+            // Handle Ctrl+A (select all text)
+            else if (c == 1) {  // ASCII value for Ctrl+A
+                // Select all the text in the document
+                hasSelection = true;
+                selectionStartX = 0;
+                selectionStartY = 0;
+                selectionEndX = lines.empty() ? 0 : lines.back().size();
+                selectionEndY = lines.size() - 1;
+                cursorX = selectionEndX;
+                cursorY = selectionEndY;
+            }
+            // Handle special key input (like arrow keys, function keys, etc.)
+            else if (c == 224) {  // Special key (like arrow keys, etc.)
+                int c2 = terminal->readKey();  // Get the second part of the special key
+    
+                // Ignore control characters in the range [1, 31]
+                if (c2 >= 1 && c2 <= 31) {
+                    return true;
                 }
-                // Handle Ctrl+R (resize the window and reload colors)
-                else if (c == 18) { // ctrl + r (resize and reload)
-                    getWindowSize(screenRows, screenCols);
-                    loadColorConfig(getNiteConfigPath());
-                    
-                    // Update file browser dimensions if active
-                    if (inFileBrowserMode && fileNavigator) {
-                        fileNavigator = std::make_unique<FileNavigator>(
-                            fileNavigator->getCurrentDirectory().string(),
-                            screenRows, screenCols
-                        );
-                    }
+    
+                // Move the cursor according to the key pressed
+                moveCursorKey(c2, shiftPressed);
+            }
+            // Handle Ctrl+F (find functionality)
+            else if (c == 6) {  // ASCII value for Ctrl+F
+                search();
+            }
+            // Handle Ctrl+H (replace functionality)
+            else if (c == 8 && ctrlPressed) {  // Ctrl+H
+                replaceAll();
+            }
+            // Handle Ctrl+N key for "Find Next"
+            else if (c == 14) {  // ASCII value for Ctrl+N
+                findNext();
+            }
+            // Handle Escape key (cancel selection or exit)
+            else if (c == 27) {  // Escape key
+                if (hasSelection) {
+                    cancelSelection();  // Cancel any active selection
+                } else if (searchActive) {
+                    searchActive = false;  // Clear the search match highlighting
                 }
-                // Handle syntax higlighting toggle
-                else if (c == 20) { // ctrl + t (toggle syntax highlighting)
-                    syntaxHighlighting = !syntaxHighlighting;
+            }
+            // Handle Tab key (insert tab)
+            else if (c == '\t') {  // Tab key
+                insertTab();
+            }
+            // Handle Enter key (insert a new line)
+            else if (c == '\r') {  // Enter key
+                insertNewLine();
+            }
+            // Handle Backspace key (delete the previous character)
+            else if (c == 8) {  // Backspace key
+                deleteChar();
+            }
+            // Handle Delete key (delete a word)
+            else if (c == 127) {  // DEL key
+                deleteWord();
+            }
+            // Handle Ctrl+S (save the file)
+            else if (c == 19) {  // Ctrl+S
+                saveFile();
+            }
+            // Handle Ctrl+O (open a file using file browser)
+            else if (c == 15) {  // Ctrl+O
+                // Use file browser mode instead of text input for opening files
+                inFileBrowserMode = true;
+                fileNavigator = std::make_unique<FileNavigator>(
+                    fs::current_path().string(),
+                    screenRows, screenCols
+                );
+            }
+            // Handle Ctrl+. (Delete the selected text)
+            else if (c == 46 && ctrlPressed) {  // Ctrl+. (Delete selection)
+                if (hasSelection) {
+                    deleteSelection();
                 }
-                // Handle printable characters (text input)
-                else if (c >= 32 && c <= 126) {  // Printable characters (ASCII)
-                    insertChar((char)c);  // Insert the character into the document
+            }
+            // Handle Ctrl+Q (quit the editor)
+            else if (c == 17) {  // Ctrl+Q
+                return false;  // Quit
+            }
+            // Handle Ctrl+P (fuzzy-open a file from the project)
+            else if (c == 16) {
+                // The project is only indexed once the palette is first wanted
+                if (!fuzzyFinder) {
+                    fs::path projectRoot = fs::current_path();
+                    fuzzyFinder = std::make_unique<FuzzyFinder>(projectRoot, persistPathIndex ? pathIndexCacheFile(projectRoot) : "");
                 }
-        
-                // Ensure the scroll position and editor content are updated after each key press
-                scroll();
-                render();
+                inFuzzyFinderMode = true;
+                fuzzyFinder->open(screenRows, screenCols);
+            }
+            // Handle Ctrl+E (reopen the results of the last directory search)
+            else if (c == 5) {
+                showSearchResults();
+            }
+            // Handle Ctrl+G (go to a specific line)
+            else if (c == 7) {
+                startStatusInput("Enter line number to scroll to: ", GOTO_LINE);
             }
+            // Handle Ctrl+R (re-read the window size and reload colors)
+            else if (c == 18) { // ctrl + r (resize and reload)
+                terminal->refreshSize();
+                applyWindowSize();
+                loadColorConfig(getNiteConfigPath());
+                minimap.invalidate();  // The watch list may have changed
+                syntaxCache.reset();   // And so may the token colors
+                screen.invalidate();  // Repaint every cell in case the console was cleared or rescaled
+            }
+            // Handle syntax higlighting toggle
+            else if (c == 20) { // ctrl + t (toggle syntax highlighting)
+                syntaxHighlighting = !syntaxHighlighting;
+            }
+            // Handle soft wrap toggle
+            else if (c == 23) { // ctrl + w (toggle soft wrap)
+                softWrap = !softWrap;
+                rowSegment = 0;
+                colOffset = 0;
+                if (!softWrap) wrapLayout.reset();  // Nothing to keep up to date while it is off
+            }
+            // Handle Ctrl+B (toggle the minimap)
+            else if (c == 2) {
+                showMinimap = !showMinimap;
+                if (!showMinimap) minimap.invalidate();  // Only edited flags are kept while it is hidden
+            }
+            // Handle printable characters (text input)
+            else if (c >= 32 && c <= 126) {  // Printable characters (ASCII)
+                insertChar((char)c);  // Insert the character into the document
+            }
+
+            return true;
         }
         
         void openFileFromPath(const std::string& path) {
             // Clear the current document
             lines.clear();
+            linesReset();
             cursorX = 0;
             cursorY = 0;
             rowOffset = 0;
             colOffset = 0;
+            rowSegment = 0;
             hasSelection = false;
             
             // Open the file
@@ -2178,9 +6898,11 @@ class Nite {
                     lines.push_back("");
                 }
                 
-                // Update the current filename
+                // Update the current filename (saving and the status bar use `filename`)
                 currentFile = path;
+                filename = path;
                 isModified = false;
+                dirty = false;
             } else {
                 // Handle file open error
                 lines.push_back("");
@@ -2199,29 +6921,67 @@ class Nite {
 };
 
 int main(int argc, char* argv[]) {
-    // Set the console's output code page to UTF-8 for proper handling of Unicode characters
-    SetConsoleOutputCP(65001);
-
-    // Enable VT100 terminal sequences (this is for supporting advanced text formatting and colors in the console)
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);  // Get the handle to the console output
-    DWORD dwMode = 0;
-    // Get the current console mode
-    GetConsoleMode(hOut, &dwMode);
-    // Enable the processing of virtual terminal sequences (like color codes)
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    // Set the console mode with the updated options
-    SetConsoleMode(hOut, dwMode);
+    // Headless runs draw into memory instead of the terminal: --bench prints per-frame timings and
+    // output sizes, --dump prints the last frame (to compare against a saved golden frame). Both
+    // take --size <rows>x<cols> and --keys <script> (see HeadlessTerminal::addKeys).
+    enum { INTERACTIVE, BENCH, DUMP } mode = INTERACTIVE;
+    int headlessRows = 24, headlessCols = 80;
+    std::string keyScript;
+    bool keysGiven = false;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench") {
+            mode = BENCH;
+        } else if (arg == "--dump") {
+            mode = DUMP;
+        } else if (arg == "--size" && i + 1 < argc) {
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            headlessRows = std::atoi(size.c_str());
+            headlessCols = x == std::string::npos ? 0 : std::atoi(size.c_str() + x + 1);
+            if (headlessRows < 2 || headlessCols < 10) {
+                std::cerr << "--size expects <rows>x<cols>, e.g. 24x80" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--keys" && i + 1 < argc) {
+            keyScript = argv[++i];
+            keysGiven = true;
+        } else {
+            arguments.push_back(arg);
+        }
+    }
+
+    HeadlessTerminal* headless = nullptr;
+    if (mode == INTERACTIVE) {
+        // Take over the terminal: the Windows console or a POSIX terminal in raw mode
+        terminal = createTerminalBackend();
+        renderer.start();  // Frames are written to it from the render thread
+    } else {
+        // Scroll down and back up through the file, then type and erase a few characters
+        if (mode == BENCH && !keysGiven) keyScript = "<down*200><pgdn*40><pgup*40>hello, world<bs*12>";
+        auto target = std::make_unique<HeadlessTerminal>(headlessRows, headlessCols);
+        std::string error;
+        if (!target->addKeys(keyScript, error)) {
+            std::cerr << "--keys: " << error << std::endl;
+            return 1;
+        }
+        headless = target.get();
+        terminal = std::move(target);  // No render thread: each frame is drawn as it is published
+    }
 
     // Create an instance of the `Editor` class to handle file editing and input processing
     Nite editor;
+    if (mode == DUMP) governorEnabled = false;  // A dump must not depend on how fast this machine is
+    if (mode != INTERACTIVE) editor.persistPathIndex = false;  // Scripted runs leave no index behind
 
-    // If a file path is provided as a command-line argument (i.e., argc >= 2)
-    // Open the file specified in argv[1] and load its content into the editor
-    if (argc >= 2)
-        if (std::string(argv[1]) == "explorer") {
+    // If a file path is provided as a command-line argument
+    // Open that file and load its content into the editor
+    if (!arguments.empty())
+        if (arguments[0] == "explorer") {
             editor.toggleFileNavigator();
         } else {
-            editor.openFile(argv[1]);
+            editor.openFile(arguments[0]);
         }
     else
         // If no file is provided, initialize the editor with an empty line
@@ -2230,6 +6990,22 @@ int main(int argc, char* argv[]) {
     // Begin processing the user's input (key presses, commands, etc.)
     editor.processInput();
 
+    // Let the last frame finish drawing, then hand the terminal back in the state we found it
+    renderer.stop();
+    if (mode == BENCH) {
+        headless->writeStats(std::cout);
+        editor.writeLexStats(std::cout);
+    }
+    if (mode == DUMP) headless->writeScreen(std::cout);
+    terminal->clear();
+    terminal.reset();
+
+#ifdef NITE_DEBUG_ALLOCS
+    // Early frames (one per recycled snapshot), resizes and new searches grow buffers; steady-state frames should not
+    std::cerr << "Frames built: " << editor.framesDrawn << ", frames that allocated: " << editor.framesAllocating << std::endl;
+    std::cerr << "Frames presented: " << renderer.framesPresented << ", frames that allocated: " << renderer.framesAllocating << std::endl;
+#endif
+
     // Return 0 to indicate successful execution
     return 0;
 }
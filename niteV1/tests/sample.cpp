@@ -0,0 +1,52 @@
+// Fixture for the golden-frame tests (make test). Editing it changes every golden.
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* A block comment
+   spanning several lines, with "quotes" and 'chars' inside */
+
+namespace demo {
+
+template <typename T>
+class Stack {
+    public:
+        void push(const T& value) { items.push_back(value); }
+
+        T pop() {
+            if (items.empty()) throw std::runtime_error("pop on an empty stack");  // TODO: return optional
+            T top = items.back();
+            items.pop_back();
+            return top;
+        }
+
+        bool empty() const noexcept { return items.empty(); }
+
+    private:
+        std::vector<T> items;
+};
+
+}  // namespace demo
+
+int main(int argc, char** argv) {
+    demo::Stack<int> numbers;
+    for (int i = 0; i < 10; ++i) numbers.push(i * 0x10 + 3);
+
+    const char* name = argc > 1 ? argv[1] : "world";
+    std::string greeting = std::string("Hello, ") + name + "!\n";
+    std::cout << greeting;
+
+    int sum = 0;
+    while (!numbers.empty()) {
+        sum += numbers.pop();  // FIXME: overflow for long inputs
+    }
+    auto halve = [](double x) { return x / 2.0; };
+    std::cout << "sum = " << sum << ", half = " << halve(sum) << std::endl;
+
+    bool ok = sum > 100 && sum % 2 == 1;
+    char quote = '\'';
+    std::cout << (ok ? "ok" : "not ok") << ' ' << quote << nullptr << std::endl;
+    return ok ? 0 : 1;
+}
+
+// A line long enough to run past the right edge of an 80-column window, so horizontal scrolling and soft wrap have something to do with it.